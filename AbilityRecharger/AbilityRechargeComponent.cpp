@@ -0,0 +1,357 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectUnrest/GAS/AbilityRechargeComponent.h"
+#include "AbilitySystemComponent.h"
+#include "ProjectUnrest/GAS/PUGameplayEffect.h"
+#include "ProjectUnrest/Telemetry/PUTelemetry.h"
+#include "ProjectUnrest/Telemetry/PUProfiling.h"
+#include "ProjectUnrest/Actors/BackpackMemory.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+
+namespace
+{
+	/* Serializes an attribute as its attribute set class path and property name, which stay valid across levels */
+	void SerializeAttribute(FArchive& Ar, FGameplayAttribute& Attribute)
+	{
+		FSoftClassPath AttributeSetClass;
+		FName AttributeName;
+
+		if (Ar.IsSaving())
+		{
+			AttributeSetClass = FSoftClassPath(Attribute.GetAttributeSetClass());
+			AttributeName = Attribute.GetUProperty() ? Attribute.GetUProperty()->GetFName() : NAME_None;
+		}
+
+		Ar << AttributeSetClass << AttributeName;
+
+		if (Ar.IsLoading())
+		{
+			UClass* Class = AttributeSetClass.ResolveClass();
+			Attribute = FGameplayAttribute(Class ? FindFProperty<FProperty>(Class, AttributeName) : nullptr);
+		}
+	}
+}
+
+
+
+UAbilityRechargeComponent::UAbilityRechargeComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UAbilityRechargeComponent::Init(UAbilitySystemComponent* _ASC)
+{
+	check(_ASC);
+
+	OwnerASC = _ASC;
+
+	PoolStates.SetNum(Pools.Num());
+}
+
+UAbilityRechargeComponent* UAbilityRechargeComponent::FindForASC(UAbilitySystemComponent* AbilitySystemComponent)
+{
+	check(AbilitySystemComponent);
+
+	AActor* Owner = AbilitySystemComponent->GetOwner();
+	UAbilityRechargeComponent* RechargeComponent = Owner ? Owner->FindComponentByClass<UAbilityRechargeComponent>() : nullptr;
+
+	if (RechargeComponent && RechargeComponent->OwnerASC == nullptr)
+	{
+		RechargeComponent->Init(AbilitySystemComponent);
+	}
+
+	return RechargeComponent;
+}
+
+int32 UAbilityRechargeComponent::AddPool(const FRechargePool& Pool)
+{
+	LLM_SCOPE_BYTAG(PU_Recharger);
+
+	int32 PoolIndex = FindPoolIndex(Pool.RechargeTag);
+
+	if (PoolIndex == INDEX_NONE)
+	{
+		PoolIndex = Pools.Add(Pool);
+		PoolStates.AddDefaulted();
+	}
+
+	return PoolIndex;
+}
+
+bool UAbilityRechargeComponent::StartRecharge(FGameplayTag RechargeTag)
+{
+	const int32 PoolIndex = FindPoolIndex(RechargeTag);
+
+	if (!ensureMsgf(PoolIndex != INDEX_NONE, TEXT("No recharge pool with tag: %s"), *RechargeTag.ToString()))
+	{
+		return false;
+	}
+
+	return StartRechargeAtIndex(PoolIndex);
+}
+
+bool UAbilityRechargeComponent::IsRecharging(FGameplayTag RechargeTag) const
+{
+	const int32 PoolIndex = FindPoolIndex(RechargeTag);
+
+	return PoolIndex != INDEX_NONE && PoolStates[PoolIndex].bRecharging;
+}
+
+float UAbilityRechargeComponent::GetTimeLeft(FGameplayTag RechargeTag) const
+{
+	const int32 PoolIndex = FindPoolIndex(RechargeTag);
+
+	if (PoolIndex == INDEX_NONE || !PoolStates[PoolIndex].bRecharging)
+	{
+		return 0.f;
+	}
+
+	return FMath::Max(0.f, static_cast<float>(PoolStates[PoolIndex].NextChargeTime - GetWorld()->GetTimeSeconds()));
+}
+
+
+void UAbilityRechargeComponent::SaveSnapshot(TArray<uint8>& OutData) const
+{
+	OutData.Reset();
+	FMemoryWriter Ar(OutData);
+
+	uint8 Version = SnapshotVersion;
+	int32 NumRecharging = PoolStates.FilterByPredicate([](const FRechargePoolState& State) { return State.bRecharging; }).Num();
+
+	Ar << Version << NumRecharging;
+
+	for (int32 i = 0; i < Pools.Num(); i++)
+	{
+		if (!PoolStates[i].bRecharging)
+		{
+			continue;
+		}
+
+		FRechargePool Pool = Pools[i];
+		FName TagName = Pool.RechargeTag.GetTagName();
+		float Charges = GetAttributeValue(Pool.ChargesAttribute);
+		float TimeLeft = GetTimeLeft(Pool.RechargeTag);
+
+		Ar << TagName;
+		SerializeAttribute(Ar, Pool.ChargesAttribute);
+		SerializeAttribute(Ar, Pool.MaxChargesAttribute);
+		SerializeAttribute(Ar, Pool.RechargeDurationAttribute);
+		Ar << Charges << TimeLeft;
+	}
+}
+
+bool UAbilityRechargeComponent::RestoreSnapshot(const TArray<uint8>& Data)
+{
+	check(OwnerASC);
+
+	FMemoryReader Ar(Data);
+
+	uint8 Version = 0;
+	int32 NumRecharging = 0;
+	Ar << Version << NumRecharging;
+
+	if (Ar.IsError() || Version != SnapshotVersion || NumRecharging < 0)
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < NumRecharging; i++)
+	{
+		FRechargePool Pool;
+		FName TagName;
+		float Charges = 0.f;
+		float TimeLeft = 0.f;
+
+		Ar << TagName;
+		SerializeAttribute(Ar, Pool.ChargesAttribute);
+		SerializeAttribute(Ar, Pool.MaxChargesAttribute);
+		SerializeAttribute(Ar, Pool.RechargeDurationAttribute);
+		Ar << Charges << TimeLeft;
+
+		if (Ar.IsError())
+		{
+			return false;
+		}
+
+		Pool.RechargeTag = FGameplayTag::RequestGameplayTag(TagName, false);
+
+		if (!ensureMsgf(Pool.RechargeTag.IsValid() && Pool.ChargesAttribute.IsValid(), TEXT("Invalid recharge pool in snapshot: %s"), *TagName.ToString()))
+		{
+			continue;
+		}
+
+		const int32 PoolIndex = AddPool(Pool);
+
+		// Charges must be restored first, since a pool at max charges does not start recharging
+		OwnerASC->SetNumericAttributeBase(Pool.ChargesAttribute, Charges);
+
+		FRechargePoolState& State = PoolStates[PoolIndex];
+
+		// A pool that is already recharging resumes from the snapshot's progress rather than its own
+		if (State.bRecharging)
+		{
+			State.NextChargeTime = GetWorld()->GetTimeSeconds() + TimeLeft;
+			SetRechargeTimer();
+		}
+		else
+		{
+			StartRechargeAtIndex(PoolIndex, TimeLeft);
+		}
+	}
+
+	return true;
+}
+
+
+int32 UAbilityRechargeComponent::FindPoolIndex(FGameplayTag RechargeTag) const
+{
+	return Pools.IndexOfByPredicate([RechargeTag](const FRechargePool& Pool) { return Pool.RechargeTag == RechargeTag; });
+}
+
+bool UAbilityRechargeComponent::StartRechargeAtIndex(int32 PoolIndex, float FirstDelay)
+{
+	check(OwnerASC);
+
+	FRechargePoolState& State = PoolStates[PoolIndex];
+	const FRechargePool& Pool = Pools[PoolIndex];
+
+	if (State.bRecharging)
+	{
+		return false;
+	}
+
+	const float Charges = GetAttributeValue(Pool.ChargesAttribute);
+
+	if (Charges == GetAttributeValue(Pool.MaxChargesAttribute))
+	{
+		return false;
+	}
+
+
+	UWorld* World = GetWorld();
+	checkf(World != nullptr, TEXT("World is nullptr"));
+
+	const float ChargeDuration = FirstDelay > 0.f ? FirstDelay : GetAttributeValue(Pool.RechargeDurationAttribute);
+
+	State.bRecharging = true;
+	State.NextChargeTime = World->GetTimeSeconds() + ChargeDuration;
+
+	OwnerASC->AddLooseGameplayTag(Pool.RechargeTag);
+
+	SetRechargeTimer();
+
+	FPUTelemetry::Record(EPUTelemetryEvent::RechargeStart, Pool.RechargeTag.GetTagName(), ChargeDuration, GetOwner()->GetUniqueID());
+
+	return true;
+}
+
+void UAbilityRechargeComponent::SetRechargeTimer()
+{
+	UWorld* World = GetWorld();
+	checkf(World != nullptr, TEXT("World is nullptr"));
+
+	double EarliestChargeTime = TNumericLimits<double>::Max();
+
+	for (const FRechargePoolState& State : PoolStates)
+	{
+		if (State.bRecharging)
+		{
+			EarliestChargeTime = FMath::Min(EarliestChargeTime, State.NextChargeTime);
+		}
+	}
+
+	FTimerManager& TimerManager = World->GetTimerManager();
+
+	if (EarliestChargeTime == TNumericLimits<double>::Max())
+	{
+		TimerManager.ClearTimer(RechargeTimer);
+		return;
+	}
+
+	// A delay of zero would clear the timer instead of setting it
+	const float Delay = FMath::Max(static_cast<float>(EarliestChargeTime - World->GetTimeSeconds()), UE_KINDA_SMALL_NUMBER);
+
+	TimerManager.SetTimer(RechargeTimer, this, &UAbilityRechargeComponent::ExecuteRecharges, Delay, false);
+}
+
+void UAbilityRechargeComponent::ExecuteRecharges()
+{
+	CSV_SCOPED_TIMING_STAT(PUShooting, Recharge);
+	CSV_CUSTOM_STAT(PUShooting, RechargeCount, 1, ECsvCustomStatOp::Accumulate);
+	LLM_SCOPE_BYTAG(PU_Recharger);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	TArray<int32, TInlineAllocator<8>> DuePoolIndices;
+
+	for (int32 i = 0; i < PoolStates.Num(); i++)
+	{
+		if (PoolStates[i].bRecharging && PoolStates[i].NextChargeTime <= Now)
+		{
+			DuePoolIndices.Add(i);
+		}
+	}
+
+	if (DuePoolIndices.Num() > 0)
+	{
+		ApplyEffectToIncrementCharges(DuePoolIndices);
+	}
+
+
+	for (int32 PoolIndex : DuePoolIndices)
+	{
+		const FRechargePool& Pool = Pools[PoolIndex];
+		FRechargePoolState& State = PoolStates[PoolIndex];
+
+		const float Charges = GetAttributeValue(Pool.ChargesAttribute);
+
+		FPUTelemetry::Record(EPUTelemetryEvent::RechargeComplete, Pool.RechargeTag.GetTagName(), Charges, GetOwner()->GetUniqueID());
+
+		if (Charges == GetAttributeValue(Pool.MaxChargesAttribute))
+		{
+			State.bRecharging = false;
+			OwnerASC->RemoveLooseGameplayTag(Pool.RechargeTag);
+
+			continue;
+		}
+
+		// Scheduled from when the charge was due rather than when the timer fired, so N charges take N durations. A pool that fell a
+		// whole duration behind (e.g. after a hitch) restarts from now instead of catching up with a burst of charges.
+		const float Duration = GetAttributeValue(Pool.RechargeDurationAttribute);
+
+		State.NextChargeTime = Now - State.NextChargeTime < Duration ? State.NextChargeTime + Duration : Now + Duration;
+	}
+
+	SetRechargeTimer();
+}
+
+void UAbilityRechargeComponent::ApplyEffectToIncrementCharges(const TArray<int32, TInlineAllocator<8>>& PoolIndices) const
+{
+	UPUGameplayEffect* GEIncrementCharges = NewObject<UPUGameplayEffect>(GetTransientPackage());
+
+	GEIncrementCharges->DurationPolicy = EGameplayEffectDurationType::Instant;
+	GEIncrementCharges->Modifiers.SetNum(PoolIndices.Num());
+
+	for (int32 i = 0; i < PoolIndices.Num(); i++)
+	{
+		FGameplayModifierInfo& StackModifier = GEIncrementCharges->Modifiers[i];
+		StackModifier.Attribute = Pools[PoolIndices[i]].ChargesAttribute;
+		StackModifier.ModifierOp = EGameplayModOp::Additive;
+		StackModifier.ModifierMagnitude = FScalableFloat(1);
+	}
+
+	OwnerASC->ApplyGameplayEffectToSelf(GEIncrementCharges, 1, OwnerASC->MakeEffectContext());
+	FBackpackMemoryTracker::CountTransientEffect();
+}
+
+float UAbilityRechargeComponent::GetAttributeValue(const FGameplayAttribute& Attribute) const
+{
+	bool bFoundAttribute = false;
+	float Value = OwnerASC->GetGameplayAttributeValue(Attribute, bFoundAttribute);
+	ensure(bFoundAttribute);
+
+	return Value;
+}
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "AttributeSet.h"
+#include "GameplayTagContainer.h"
+#include "AbilityRechargeComponent.generated.h"
+
+
+class UAbilitySystemComponent;
+
+
+/* The attributes and tag describing one stack of ability charges */
+USTRUCT(BlueprintType)
+struct FRechargePool
+{
+	GENERATED_BODY()
+
+	/* The meta attribute holding the current number of ability uses left */
+	UPROPERTY(EditDefaultsOnly, Category = "Recharge Pool")
+		FGameplayAttribute ChargesAttribute;
+
+	/* The attribute specifying the maximum charges in a stack */
+	UPROPERTY(EditDefaultsOnly, Category = "Recharge Pool")
+		FGameplayAttribute MaxChargesAttribute;
+
+	/* The attribute specifying the duration to recharge a single charge */
+	UPROPERTY(EditDefaultsOnly, Category = "Recharge Pool")
+		FGameplayAttribute RechargeDurationAttribute;
+
+	/* The tag to place on owner actor while it is recharging. Identifies the pool, so must be unique per component. */
+	UPROPERTY(EditDefaultsOnly, Category = "Recharge Pool")
+		FGameplayTag RechargeTag;
+};
+
+
+/*
+ *	Recharges every stacking ability of one ASC from a single table of pools, instead of one UAbilityRecharger instance per ability.
+ *	All pools share one timer, and the pools that finish a charge in the same frame are incremented by a single gameplay effect.
+ *	Also holds the state of every UAbilityRecharger on the ASC, which registers its pool when first activated.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class PROJECTUNREST_API UAbilityRechargeComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+
+public:
+	UAbilityRechargeComponent();
+
+	/* Caches the ASC whose attributes the pools recharge. Required for the component to function. */
+	UFUNCTION(BlueprintCallable, Category = "Ability Recharge")
+		void Init(UAbilitySystemComponent* _ASC);
+
+	/* Returns the recharge component on the owner of the given ASC, initializing it with the ASC if needed */
+	static UAbilityRechargeComponent* FindForASC(UAbilitySystemComponent* AbilitySystemComponent);
+
+	/* Adds a pool unless one with the same tag exists. Returns the index of the pool with the tag. */
+	int32 AddPool(const FRechargePool& Pool);
+
+	/* Starts recharging the pool with the given tag. Returns false if it is already recharging or at max charges. */
+	UFUNCTION(BlueprintCallable, Category = "Ability Recharge")
+		bool StartRecharge(FGameplayTag RechargeTag);
+
+	/* Returns whether the pool with the given tag is recharging */
+	UFUNCTION(BlueprintCallable, Category = "Ability Recharge")
+		bool IsRecharging(FGameplayTag RechargeTag) const;
+
+	/* Returns the time left on the current charge of the pool with the given tag, or zero if it is not recharging */
+	UFUNCTION(BlueprintCallable, Category = "Ability Recharge")
+		float GetTimeLeft(FGameplayTag RechargeTag) const;
+
+
+	/* Writes a versioned snapshot of the pool, charges and time left on the current charge of every recharging pool */
+	void SaveSnapshot(TArray<uint8>& OutData) const;
+
+	/*
+	 *	Restores charges and resumes recharging every pool in a snapshot made by SaveSnapshot, with the time left it was saved with,
+	 *	including pools that are already recharging. Returns false if the snapshot is invalid.
+	 */
+	bool RestoreSnapshot(const TArray<uint8>& Data);
+
+
+protected:
+	/* The stacks of charges this component recharges */
+	UPROPERTY(EditDefaultsOnly, Category = "Ability Recharge")
+		TArray<FRechargePool> Pools;
+
+	/* Increments every pool due this frame with one effect, then stops pools at max charges */
+	void ExecuteRecharges();
+
+
+private:
+	/* Runtime state of a pool. Kept parallel to Pools. */
+	struct FRechargePoolState
+	{
+		/* World time at which the next charge is added */
+		double NextChargeTime = 0.0;
+
+		bool bRecharging = false;
+	};
+
+	TArray<FRechargePoolState> PoolStates;
+
+	/* The single timer driving every pool, set for the earliest next charge */
+	FTimerHandle RechargeTimer;
+
+	UAbilitySystemComponent* OwnerASC = nullptr;
+
+	/* Incremented whenever the snapshot layout changes */
+	static constexpr uint8 SnapshotVersion = 1;
+
+
+	/* Returns the index of the pool with the given tag, or INDEX_NONE */
+	int32 FindPoolIndex(FGameplayTag RechargeTag) const;
+
+	/* Starts recharging the pool at the given index. The first charge takes FirstDelay instead of the recharge duration if it is positive. */
+	bool StartRechargeAtIndex(int32 PoolIndex, float FirstDelay = 0.f);
+
+	/* Sets the timer for the earliest next charge of all recharging pools */
+	void SetRechargeTimer();
+
+	/* Creates and applies one GE with an increment modifier for each given pool */
+	void ApplyEffectToIncrementCharges(const TArray<int32, TInlineAllocator<8>>& PoolIndices) const;
+
+	float GetAttributeValue(const FGameplayAttribute& Attribute) const;
+};
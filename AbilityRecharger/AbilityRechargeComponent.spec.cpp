@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ProjectUnrest/Actors/ShootLoopTestFixture.h"
+#include "ProjectUnrest/Actors/ShootLoopTestTypes.h"
+#include "ProjectUnrest/GAS/AbilityRechargeComponent.h"
+#include "ProjectUnrest/GAS/PUAbilitySystemComponent.h"
+
+
+BEGIN_DEFINE_SPEC(FPUAbilityRechargeSpec, "ProjectUnrest.AbilityRecharge", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	FPUShootLoopTestWorld TestWorld;
+
+	FPUTestShooter Shooter;
+
+	const float MaxCharges = 3.f;
+
+	const float RechargeDuration = 0.5f;
+
+	const float TickDelta = 1.f / 60.f;
+
+	float GetCharges() const;
+
+	/* Spawns a shooter with the same recharge attributes, to restore snapshots into */
+	FPUTestShooter SpawnRestoreTarget();
+
+END_DEFINE_SPEC(FPUAbilityRechargeSpec)
+
+
+float FPUAbilityRechargeSpec::GetCharges() const
+{
+	return Shooter.ASC->GetNumericAttribute(UPUTestAttributeSet::GetChargesAttribute());
+}
+
+
+FPUTestShooter FPUAbilityRechargeSpec::SpawnRestoreTarget()
+{
+	FPUTestShooter Target = TestWorld.SpawnShooter(false);
+
+	Target.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetMaxChargesAttribute(), MaxCharges);
+	Target.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetChargesAttribute(), 0.f);
+	Target.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetRechargeDurationAttribute(), RechargeDuration);
+
+	return Target;
+}
+
+
+void FPUAbilityRechargeSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		TestWorld.Create();
+		Shooter = TestWorld.SpawnShooter(false);
+
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetMaxChargesAttribute(), MaxCharges);
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetChargesAttribute(), 0.f);
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetRechargeDurationAttribute(), RechargeDuration);
+
+		Shooter.RechargeComponent->AddPool(FPUShootLoopTestWorld::MakeRechargePool());
+	});
+
+	AfterEach([this]()
+	{
+		TestWorld.Destroy();
+	});
+
+
+	Describe("Recharge timing", [this]()
+	{
+		It("should add each charge within a frame after its share of the recharge durations", [this]()
+		{
+			TestTrue(TEXT("Started recharging"), Shooter.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge));
+
+			const double StartTime = TestWorld.GetWorld()->GetTimeSeconds();
+
+			// Measured from the start, so a charge that fires a frame late must not delay the ones after it
+			for (int32 Charge = 1; Charge <= MaxCharges; Charge++)
+			{
+				const bool bCharged = TestWorld.TickUntil([this, Charge]() { return GetCharges() >= Charge; }, RechargeDuration * 2.f, TickDelta);
+
+				if (!TestTrue(FString::Printf(TEXT("Charge %d added"), Charge), bCharged))
+				{
+					return;
+				}
+
+				const double Elapsed = TestWorld.GetWorld()->GetTimeSeconds() - StartTime;
+				const double Expected = RechargeDuration * Charge;
+
+				TestTrue(FString::Printf(TEXT("Charge %d after %.4fs, at least %.4fs"), Charge, Elapsed, Expected), Elapsed >= Expected - UE_KINDA_SMALL_NUMBER);
+				TestTrue(FString::Printf(TEXT("Charge %d after %.4fs, at most a frame over %.4fs"), Charge, Elapsed, Expected), Elapsed <= Expected + TickDelta + UE_KINDA_SMALL_NUMBER);
+			}
+		});
+
+		It("should stop recharging and remove the tag at max charges", [this]()
+		{
+			Shooter.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge);
+
+			TestTrue(TEXT("Has recharge tag while recharging"), Shooter.ASC->HasMatchingGameplayTag(TAG_PU_Test_Recharge));
+
+			TestWorld.TickUntil([this]() { return !Shooter.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge); }, RechargeDuration * (MaxCharges + 1), TickDelta);
+
+			TestEqual(TEXT("Charges"), GetCharges(), MaxCharges);
+			TestFalse(TEXT("Is recharging"), Shooter.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge));
+			TestFalse(TEXT("Has recharge tag"), Shooter.ASC->HasMatchingGameplayTag(TAG_PU_Test_Recharge));
+
+			// No charge should be added past max
+			TestWorld.Tick(TickDelta, FMath::CeilToInt(RechargeDuration * 2.f / TickDelta));
+			TestEqual(TEXT("Charges after idling"), GetCharges(), MaxCharges);
+		});
+
+		It("should not restart a recharging or full pool", [this]()
+		{
+			TestTrue(TEXT("First start"), Shooter.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge));
+			TestFalse(TEXT("Start while recharging"), Shooter.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge));
+
+			TestWorld.TickUntil([this]() { return !Shooter.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge); }, RechargeDuration * (MaxCharges + 1), TickDelta);
+
+			TestFalse(TEXT("Start at max charges"), Shooter.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge));
+		});
+
+		It("should report the time left on the current charge", [this]()
+		{
+			Shooter.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge);
+
+			TestEqual(TEXT("Time left at start"), Shooter.RechargeComponent->GetTimeLeft(TAG_PU_Test_Recharge), RechargeDuration, UE_KINDA_SMALL_NUMBER);
+
+			TestWorld.Tick(0.2f);
+
+			TestEqual(TEXT("Time left after 0.2s"), Shooter.RechargeComponent->GetTimeLeft(TAG_PU_Test_Recharge), RechargeDuration - 0.2f, UE_KINDA_SMALL_NUMBER);
+		});
+	});
+
+	Describe("Snapshot", [this]()
+	{
+		It("should resume a recharge with the time left it was saved with", [this]()
+		{
+			const float Elapsed = 0.2f;
+
+			Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetChargesAttribute(), 1.f);
+			Shooter.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge);
+			TestWorld.Tick(Elapsed);
+
+			TArray<uint8> Snapshot;
+			Shooter.RechargeComponent->SaveSnapshot(Snapshot);
+
+			const float SavedTimeLeft = Shooter.RechargeComponent->GetTimeLeft(TAG_PU_Test_Recharge);
+			TestEqual(TEXT("Saved time left"), SavedTimeLeft, RechargeDuration - Elapsed, UE_KINDA_SMALL_NUMBER);
+
+			FPUTestShooter Target = SpawnRestoreTarget();
+
+			if (!TestTrue(TEXT("Restored snapshot"), Target.RechargeComponent->RestoreSnapshot(Snapshot)))
+			{
+				return;
+			}
+
+			TestTrue(TEXT("Is recharging"), Target.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge));
+			TestEqual(TEXT("Charges"), Target.ASC->GetNumericAttribute(UPUTestAttributeSet::GetChargesAttribute()), 1.f);
+			TestEqual(TEXT("Time left"), Target.RechargeComponent->GetTimeLeft(TAG_PU_Test_Recharge), SavedTimeLeft, UE_KINDA_SMALL_NUMBER);
+
+			// The next charge arrives after the saved time left, not a full duration
+			TestWorld.Tick(SavedTimeLeft + TickDelta);
+			TestEqual(TEXT("Charges after the time left"), Target.ASC->GetNumericAttribute(UPUTestAttributeSet::GetChargesAttribute()), 2.f);
+		});
+
+		It("should overwrite the progress of a pool that is already recharging", [this]()
+		{
+			const float Elapsed = 0.3f;
+
+			Shooter.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge);
+			TestWorld.Tick(Elapsed);
+
+			TArray<uint8> Snapshot;
+			Shooter.RechargeComponent->SaveSnapshot(Snapshot);
+
+			// The target starts its own recharge, so it is a full duration from the next charge when the snapshot is restored
+			FPUTestShooter Target = SpawnRestoreTarget();
+			Target.RechargeComponent->AddPool(FPUShootLoopTestWorld::MakeRechargePool());
+			Target.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge);
+
+			TestTrue(TEXT("Restored snapshot"), Target.RechargeComponent->RestoreSnapshot(Snapshot));
+			TestEqual(TEXT("Time left"), Target.RechargeComponent->GetTimeLeft(TAG_PU_Test_Recharge), RechargeDuration - Elapsed, UE_KINDA_SMALL_NUMBER);
+
+			TestWorld.Tick(RechargeDuration - Elapsed + TickDelta);
+			TestEqual(TEXT("Charges after the time left"), Target.ASC->GetNumericAttribute(UPUTestAttributeSet::GetChargesAttribute()), 1.f);
+		});
+	});
+}
+
+#endif
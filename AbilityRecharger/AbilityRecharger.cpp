@@ -3,104 +3,60 @@
 
 #include "ProjectUnrest/GAS/Abilities/AbilityRecharger.h"
 #include "AbilitySystemComponent.h"
-#include "ProjectUnrest/GAS/PUGameplayEffect.h"
+#include "ProjectUnrest/GAS/AbilityRechargeComponent.h"
 
 
 
-void UAbilityRecharger::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
+UAbilityRecharger::UAbilityRecharger()
 {
-	RechargeHandle = Handle;
-	RechargeActorInfo = *ActorInfo;
-	RechargeActivationInfo = ActivationInfo;
+	InstancingPolicy = EGameplayAbilityInstancingPolicy::NonInstanced;
+}
 
+void UAbilityRecharger::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
+{
 	UAbilitySystemComponent* AbilitySystemComponent = ActorInfo->AbilitySystemComponent.Get();
 
-	if (AbilitySystemComponent->HasMatchingGameplayTag(RechargeTag))
+	if (AbilitySystemComponent->HasMatchingGameplayTag(RechargeTag) || !StartRecharge(AbilitySystemComponent))
 	{
 		CancelAbility(Handle, ActorInfo, ActivationInfo, true);
 		return;
 	}
 
-
-	bool bFoundChargesAttribute = false;
-	float Charges = AbilitySystemComponent->GetGameplayAttributeValue(ChargesAttribute, bFoundChargesAttribute);
-	ensure(bFoundChargesAttribute);
-
-	bool bFoundMaxChargesAttribute = false;
-	float MaxCharges = AbilitySystemComponent->GetGameplayAttributeValue(MaxChargesAttribute, bFoundMaxChargesAttribute);
-	ensure(bFoundMaxChargesAttribute);
-
-
-	if (Charges == MaxCharges)
-	{
-		CancelAbility(Handle, ActorInfo, ActivationInfo, true);
-		return;
-	}
-
-
-	AbilitySystemComponent->AddLooseGameplayTag(RechargeTag);
-
-	SetRechargeTimer(AbilitySystemComponent);
+	// The recharge component drives the rest, so there is nothing to keep this ability active for
+	EndAbility(Handle, ActorInfo, ActivationInfo, true, false);
 }
 
-void UAbilityRecharger::SetRechargeTimer(UAbilitySystemComponent* AbilitySystemComponent)
+bool UAbilityRecharger::TryStartRecharge(UAbilitySystemComponent* AbilitySystemComponent, TSubclassOf<UAbilityRecharger> RechargerClass)
 {
-	bool bFoundRechargeDurationAttribute = false;
-	float RechargeDuration = AbilitySystemComponent->GetGameplayAttributeValue(RechargeDurationAttribute, bFoundRechargeDurationAttribute);
-	ensure(bFoundRechargeDurationAttribute);
+	check(AbilitySystemComponent);
+	check(RechargerClass);
 
-	UWorld* World = GetWorld();
-	checkf(World != nullptr, TEXT("World is nullptr"));
+	const UAbilityRecharger* RechargerCDO = RechargerClass->GetDefaultObject<UAbilityRecharger>();
 
-	FTimerManager& TimerManager = World->GetTimerManager();
-	FTimerDelegate TimerDelegate;
-
-	TimerDelegate.BindUFunction(this, FName("ExecuteRecharge"), RechargeHandle, RechargeActorInfo, RechargeActivationInfo);
-
-	TimerManager.SetTimer(RechargeTimer, TimerDelegate, 1, false, RechargeDuration);
-}
-
-void UAbilityRecharger::ExecuteRecharge()
-{
-	UAbilitySystemComponent* AbilitySystemComponent = GetAbilitySystemComponentFromActorInfo();
-
-	ApplyEffectToIncrementCharge(AbilitySystemComponent);
-
-
-	bool bFoundChargesAttribute = false;
-	float Charges = AbilitySystemComponent->GetGameplayAttributeValue(ChargesAttribute, bFoundChargesAttribute);
-	ensure(bFoundChargesAttribute);
-
-	bool bFoundMaxChargesAttribute = false;
-	float MaxCharges = AbilitySystemComponent->GetGameplayAttributeValue(MaxChargesAttribute, bFoundMaxChargesAttribute);
-	ensure(bFoundMaxChargesAttribute);
-
-
-	if (Charges == MaxCharges)
+	if (AbilitySystemComponent->HasMatchingGameplayTag(RechargerCDO->RechargeTag))
 	{
-		RechargeTimer.Invalidate();
-		AbilitySystemComponent->RemoveLooseGameplayTag(RechargeTag);
-		EndAbility(RechargeHandle, &RechargeActorInfo, RechargeActivationInfo, true, false);
-
-		return;
+		return false;
 	}
 
-	SetRechargeTimer(AbilitySystemComponent);
+	return RechargerCDO->StartRecharge(AbilitySystemComponent);
 }
 
-void UAbilityRecharger::ApplyEffectToIncrementCharge(UAbilitySystemComponent* AbilitySystemComponent) const
+bool UAbilityRecharger::StartRecharge(UAbilitySystemComponent* AbilitySystemComponent) const
 {
-	UPUGameplayEffect* GEIncrementCharge = NewObject<UPUGameplayEffect>(GetTransientPackage());
+	UAbilityRechargeComponent* RechargeComponent = UAbilityRechargeComponent::FindForASC(AbilitySystemComponent);
 
-	GEIncrementCharge->DurationPolicy = EGameplayEffectDurationType::Instant;
+	if (!ensureMsgf(RechargeComponent, TEXT("%s has no AbilityRechargeComponent"), *GetNameSafe(AbilitySystemComponent->GetOwner())))
+	{
+		return false;
+	}
 
-	const int32 ModIndex = GEIncrementCharge->Modifiers.Num();
-	GEIncrementCharge->Modifiers.SetNum(ModIndex + 1);
+	FRechargePool Pool;
+	Pool.ChargesAttribute = ChargesAttribute;
+	Pool.MaxChargesAttribute = MaxChargesAttribute;
+	Pool.RechargeDurationAttribute = RechargeDurationAttribute;
+	Pool.RechargeTag = RechargeTag;
 
-	FGameplayModifierInfo& StackModifier = GEIncrementCharge->Modifiers[ModIndex];
-	StackModifier.Attribute = ChargesAttribute;
-	StackModifier.ModifierOp = EGameplayModOp::Additive;
-	StackModifier.ModifierMagnitude = FScalableFloat(1);
+	RechargeComponent->AddPool(Pool);
 
-	AbilitySystemComponent->ApplyGameplayEffectToSelf(GEIncrementCharge, 1, AbilitySystemComponent->MakeEffectContext());
+	return RechargeComponent->StartRecharge(RechargeTag);
 }
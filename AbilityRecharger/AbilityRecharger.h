@@ -7,8 +7,11 @@
 #include "AbilityRecharger.generated.h"
 
 /*
- *	A base ability that recharges another ability that can stack by incrementing its charges attribute after recharge duration. 
+ *	A base ability that recharges another ability that can stack by incrementing its charges attribute after recharge duration.
  *	Should be inherited from only to change the attribute fields.
+ *	Non-instanced: the recharge state lives in the UAbilityRechargeComponent on the ASC owner, so it must be granted and activated with
+ *	TryActivateAbility rather than GiveAbilityAndActivateOnce, which rejects non-instanced abilities. Callers that gave and activated a
+ *	recharger once should call TryStartRecharge instead, which skips ability activation entirely.
  */
 UCLASS()
 class PROJECTUNREST_API UAbilityRecharger : public UGameplayAbility
@@ -35,24 +38,20 @@ protected:
 
 
 public:
+	UAbilityRecharger();
+
 	/* GameplayAbility callback */
 	virtual void ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData);
 
+	/*
+	 *	Starts the recharge described by the given recharger class without activating an ability.
+	 *	Returns false early, with a single tag check, if it is already recharging.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Ability Recharger")
+	static bool TryStartRecharge(UAbilitySystemComponent* AbilitySystemComponent, TSubclassOf<UAbilityRecharger> RechargerClass);
 
-private:
-	/* These fields are cached because they can't be exposed in a UFUNCTION which is necessary for a timer */
-	FTimerHandle RechargeTimer;
-	FGameplayAbilitySpecHandle RechargeHandle;
-	FGameplayAbilityActorInfo RechargeActorInfo;
-	FGameplayAbilityActivationInfo RechargeActivationInfo;
-
-	/* Sets the timer to call ExecuteRecharge after the recharge duration */
-	void SetRechargeTimer(UAbilitySystemComponent* AbilitySystemComponent);
 
-	/* Applies effect to increment charges attribute and sets a timer to repeat this if still not at max charges */
-	UFUNCTION()
-		void ExecuteRecharge();
-
-	/* Creates and applies a GE to increment the charge attribute */
-	void ApplyEffectToIncrementCharge(UAbilitySystemComponent* AbilitySystemComponent) const;
+private:
+	/* Registers this recharger's pool with the recharge component of the ASC owner and starts recharging it */
+	bool StartRecharge(UAbilitySystemComponent* AbilitySystemComponent) const;
 };
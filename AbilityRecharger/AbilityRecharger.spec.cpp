@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ProjectUnrest/Actors/ShootLoopTestFixture.h"
+#include "ProjectUnrest/Actors/ShootLoopTestTypes.h"
+#include "ProjectUnrest/GAS/AbilityRechargeComponent.h"
+#include "ProjectUnrest/GAS/Abilities/AbilityRecharger.h"
+#include "ProjectUnrest/GAS/PUAbilitySystemComponent.h"
+
+
+BEGIN_DEFINE_SPEC(FPUAbilityRechargerSpec, "ProjectUnrest.AbilityRecharger", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	FPUShootLoopTestWorld TestWorld;
+
+	FPUTestShooter Shooter;
+
+	FGameplayAbilitySpecHandle StackingAbilityHandle;
+
+	const float MaxCharges = 3.f;
+
+	const float RechargeDuration = 0.1f;
+
+	const float TickDelta = 1.f / 60.f;
+
+	float GetCharges() const;
+
+END_DEFINE_SPEC(FPUAbilityRechargerSpec)
+
+
+float FPUAbilityRechargerSpec::GetCharges() const
+{
+	return Shooter.ASC->GetNumericAttribute(UPUTestAttributeSet::GetChargesAttribute());
+}
+
+
+void FPUAbilityRechargerSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		TestWorld.Create();
+		Shooter = TestWorld.SpawnShooter(false);
+
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetMaxChargesAttribute(), MaxCharges);
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetChargesAttribute(), MaxCharges);
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetRechargeDurationAttribute(), RechargeDuration);
+
+		StackingAbilityHandle = Shooter.ASC->GiveAbility(FGameplayAbilitySpec(UPUTestStackingAbility::StaticClass()));
+	});
+
+	AfterEach([this]()
+	{
+		TestWorld.Destroy();
+	});
+
+
+	Describe("TryStartRecharge", [this]()
+	{
+		It("should start the recharge once and short-circuit on the recharge tag while recharging", [this]()
+		{
+			TestTrue(TEXT("Activated"), Shooter.ASC->TryActivateAbility(StackingAbilityHandle));
+			TestTrue(TEXT("Recharging"), Shooter.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge));
+			TestTrue(TEXT("Has recharge tag"), Shooter.ASC->HasMatchingGameplayTag(TAG_PU_Test_Recharge));
+
+			const float TimeLeft = Shooter.RechargeComponent->GetTimeLeft(TAG_PU_Test_Recharge);
+
+			TestFalse(TEXT("Started while recharging"), UAbilityRecharger::TryStartRecharge(Shooter.ASC, UPUTestAbilityRecharger::StaticClass()));
+			TestTrue(TEXT("Activated while recharging"), Shooter.ASC->TryActivateAbility(StackingAbilityHandle));
+
+			TestEqual(TEXT("Recharge pools"), Shooter.RechargeComponent->GetPoolCount(), 1);
+			TestEqual(TEXT("Time left unchanged"), Shooter.RechargeComponent->GetTimeLeft(TAG_PU_Test_Recharge), TimeLeft);
+		});
+	});
+
+
+	Describe("Stress", [this]()
+	{
+		It("should keep one recharge in range when the parent ability is activated thousands of times per second", [this]()
+		{
+			const int32 ActivationsPerSecond = 5000;
+			const float Seconds = 3.f;
+			const int32 ActivationsPerTick = FMath::CeilToInt(ActivationsPerSecond * TickDelta);
+			const int32 Ticks = FMath::CeilToInt(Seconds / TickDelta);
+
+			int32 SuccessfulActivations = 0;
+
+			for (int32 TickIndex = 0; TickIndex < Ticks; TickIndex++)
+			{
+				for (int32 i = 0; i < ActivationsPerTick; i++)
+				{
+					SuccessfulActivations += Shooter.ASC->TryActivateAbility(StackingAbilityHandle) ? 1 : 0;
+				}
+
+				const float Charges = GetCharges();
+
+				if (!TestTrue(FString::Printf(TEXT("Charges %.1f in range at tick %d"), Charges, TickIndex), Charges >= 0.f && Charges <= MaxCharges)
+					|| !TestTrue(FString::Printf(TEXT("Recharging while below max at tick %d"), TickIndex), Charges == MaxCharges || Shooter.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge)))
+				{
+					return;
+				}
+
+				TestWorld.Tick(TickDelta);
+			}
+
+			// Every activation re-registers the recharger's pool, which must not add a pool per activation
+			TestEqual(TEXT("Recharge pools"), Shooter.RechargeComponent->GetPoolCount(), 1);
+
+			// The starting charges, plus one per recharge, each of which is spent on the frame after it is added. A recharge can run a frame over.
+			const int32 MinActivations = static_cast<int32>(MaxCharges) + FMath::FloorToInt(Seconds / (RechargeDuration + TickDelta));
+			const int32 MaxActivations = static_cast<int32>(MaxCharges) + FMath::CeilToInt(Seconds / RechargeDuration);
+
+			TestTrue(FString::Printf(TEXT("%d activations succeeded, expected %d to %d"), SuccessfulActivations, MinActivations, MaxActivations),
+				SuccessfulActivations >= MinActivations && SuccessfulActivations <= MaxActivations);
+		});
+
+		It("should recharge to max after the activations stop", [this]()
+		{
+			for (int32 i = 0; i < 1000; i++)
+			{
+				Shooter.ASC->TryActivateAbility(StackingAbilityHandle);
+			}
+
+			TestEqual(TEXT("Charges after spending"), GetCharges(), 0.f);
+
+			TestTrue(TEXT("Recharged to max"), TestWorld.TickUntil([this]() { return !Shooter.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge); },
+				RechargeDuration * (MaxCharges + 1), TickDelta));
+
+			TestEqual(TEXT("Charges"), GetCharges(), MaxCharges);
+			TestFalse(TEXT("Has recharge tag"), Shooter.ASC->HasMatchingGameplayTag(TAG_PU_Test_Recharge));
+		});
+	});
+}
+
+#endif
@@ -3,40 +3,123 @@
 
 #include "ProjectUnrest/Actors/Backpack.h"
 #include "ProjectUnrest/Actors/Battery.h"
+#include "ProjectUnrest/Actors/BackpackMemory.h"
+#include "ProjectUnrest/Actors/VisualSignificance.h"
+#include "NiagaraComponent.h"
+#include "NiagaraFunctionLibrary.h"
 #include "ProjectUnrest/GAS/PUAbilitySystemComponent.h"
+#include "ProjectUnrest/Telemetry/PUTelemetry.h"
+#include "ProjectUnrest/Telemetry/PUProfiling.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Engine/World.h"
+#include "UObject/ObjectKey.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPUBackpack, Log, All);
+
+
+namespace
+{
+	/* The battery types whose VFX have been warmed up, by world. Pooled VFX belong to their world, so every backpack in it shares them. */
+	TMap<TObjectKey<UWorld>, TSet<TObjectKey<UClass>>> WarmedBatteryTypes;
+}
 
 
 ABackpack::ABackpack()
 {
-	PrimaryActorTick.bCanEverTick = false;
+	LLM_SCOPE_BYTAG(PU_Backpack);
+
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	bVisualsSignificant = !FPUVisualSignificance::AreVisualsStripped();
+
+	// Dedicated servers only need a transform for the batteries to attach to
+	if (!bVisualsSignificant)
+	{
+		SetRootComponent(CreateDefaultSubobject<USceneComponent>(TEXT("Root")));
+	}
+	else
+	{
+		BackpackMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("BackpackMesh"));
+		SetRootComponent(BackpackMesh);
+	}
+}
+
+void ABackpack::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
 
-	BackpackMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("BackpackMesh"));
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(BatteryTypeCounts.GetAllocatedSize());
 }
 
 
 void ABackpack::Init(ACharacter* _OwningCharacter, UPUAbilitySystemComponent* _ASC)
 {
+	LLM_SCOPE_BYTAG(PU_Backpack);
+
 	check(_OwningCharacter);
 	check(_ASC);
+	check(OwnedBatteriesCount <= FBackpackView::MaxSlots);
 
 	OwnerCharacter = _OwningCharacter;
 	OwnerASC = _ASC;
 
 	CurrentBatteryChangedEvent.AddDynamic(this, &ABackpack::UpdateEmissiveMaterial);
+	CurrentBatteryChangedEvent.AddDynamic(this, &ABackpack::WarmUpUpcomingBatteries);
+	CurrentBatteryChangedEvent.AddDynamic(this, &ABackpack::MarkViewDirty);
+
+	UE_CLOG(RechamberDuration <= 0.f || ReloadDuration <= 0.f, LogPUBackpack, Warning,
+		TEXT("%s has no rechamber or reload duration, so owners without visuals, e.g. on servers, will rechamber or reload instantly"), *GetNameSafe(GetClass()));
 
 	CreateInitialBatteries();
 	CountBatteryTypes();
+
+	FPUVisualSignificance::Register(this, [this](bool bSignificant) { SetVisualsSignificant(bSignificant); });
+
+	checkCode(CheckInvariants());
+}
+
+
+void ABackpack::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FPUVisualSignificance::Unregister(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+void ABackpack::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	PublishView();
+
+	SetActorTickEnabled(false);
 }
 
 
 void ABackpack::Rechamber_Exec()
 {
+	// A rechamber still pending from a shot within RechamberDuration has to land before the index is checked for a reload
+	FlushPendingCalls();
+
+	FPUTelemetry::Record(EPUTelemetryEvent::Rechamber, GetCurrentBattery()->GetBatteryTypeTag().GetTagName(), CurrentBatteryIndex, GetUniqueID());
+
 	if (CurrentBatteryIndex == OwnedBatteriesCount - 1)
 	{
 		ActivateReloadAbility();
 		return;
 	}
 
+	// Only the animation is skipped. The rechamber still takes as long, so the owner can't shoot faster and a server stays in step with clients.
+	if (!bVisualsSignificant)
+	{
+		CallAfterDuration(RechamberTimer, &ABackpack::Rechamber_CPP, RechamberDuration);
+		return;
+	}
+
 	Rechamber_BP();
 }
 
@@ -48,18 +131,33 @@ void ABackpack::Rechamber_CPP()
 	{
 		CurrentBatteryChangedEvent.Broadcast();
 	}
+
+	checkCode(CheckInvariants());
 }
 
 
 void ABackpack::Reload_Exec()
 {
+	FlushPendingCalls();
+
+	if (!bVisualsSignificant)
+	{
+		CallAfterDuration(ReloadTimer, &ABackpack::Reload_CPP, ReloadDuration);
+		return;
+	}
+
 	Reload_BP();
 }
 
 void ABackpack::Reload_CPP()
 {
+	CSV_SCOPED_TIMING_STAT(PUShooting, Reload);
+	CSV_CUSTOM_STAT(PUShooting, ReloadCount, 1, ECsvCustomStatOp::Accumulate);
+
 	CurrentBatteryIndex = 0;
 
+	FPUTelemetry::Record(EPUTelemetryEvent::Reload, NAME_None, OwnedBatteriesCount, GetUniqueID());
+
 	for (auto Battery : OwnedBatteries)
 	{
 		Battery->Recharge_Exec();
@@ -69,6 +167,8 @@ void ABackpack::Reload_CPP()
 	{
 		CurrentBatteryChangedEvent.Broadcast();
 	}
+
+	checkCode(CheckInvariants());
 }
 
 
@@ -93,7 +193,14 @@ void ABackpack::InsertNewBattery(TSubclassOf<ABattery> NewBatteryClass, int32 Ch
 
 
 	// Create new battery and add to count
-	ABattery* NewBattery = Cast<ABattery>(World->SpawnActor(NewBatteryClass));
+	BakeBatteryType(NewBatteryClass);
+
+	ABattery* NewBattery = nullptr;
+	{
+		LLM_SCOPE_BYTAG(PU_Batteries);
+		NewBattery = Cast<ABattery>(World->SpawnActor(NewBatteryClass));
+	}
+
 	OwnedBatteries[ChamberIndex] = NewBattery;
 
 	FGameplayTag NewType = OwnedBatteries[ChamberIndex]->GetBatteryTypeTag();
@@ -108,13 +215,19 @@ void ABackpack::InsertNewBattery(TSubclassOf<ABattery> NewBatteryClass, int32 Ch
 		BatteryTypeCounts.Emplace(NewType, *NewTypeCount + 1);
 	}
 
-	AttachBatteryToSocket(NewBattery, ChamberIndex);
+	AttachBattery(NewBattery, ChamberIndex);
+	NewBattery->SetVisualsSignificant(bVisualsSignificant);
 
 
+	// The view covers every slot, not only the current one
+	MarkViewDirty();
+
 	if (CurrentBatteryIndex == ChamberIndex && CurrentBatteryChangedEvent.IsBound())
 	{
 		CurrentBatteryChangedEvent.Broadcast();
 	}
+
+	checkCode(CheckInvariants());
 }
 
 void ABackpack::SwapOwnedBatteries(int32 FirstBatteryIndex, int32 SecondBatteryIndex)
@@ -130,15 +243,20 @@ void ABackpack::SwapOwnedBatteries(int32 FirstBatteryIndex, int32 SecondBatteryI
 	OwnedBatteries[FirstBatteryIndex] = OwnedBatteries[SecondBatteryIndex];
 	OwnedBatteries[SecondBatteryIndex] = TempBatteryPtr;
 
-	AttachBatteryToSocket(OwnedBatteries[FirstBatteryIndex], FirstBatteryIndex);
-	AttachBatteryToSocket(OwnedBatteries[SecondBatteryIndex], SecondBatteryIndex);
+	AttachBattery(OwnedBatteries[FirstBatteryIndex], FirstBatteryIndex);
+	AttachBattery(OwnedBatteries[SecondBatteryIndex], SecondBatteryIndex);
 
 
+	// The view covers every slot, not only the current one
+	MarkViewDirty();
+
 	bool bSwappedCurrentBattery = CurrentBatteryIndex == FirstBatteryIndex || CurrentBatteryIndex == SecondBatteryIndex;
 	if (bSwappedCurrentBattery && CurrentBatteryChangedEvent.IsBound())
 	{
 		CurrentBatteryChangedEvent.Broadcast();
 	}
+
+	checkCode(CheckInvariants());
 }
 
 
@@ -156,6 +274,112 @@ void ABackpack::DischargeCurrentBattery()
 }
 
 
+bool ABackpack::SaveSnapshot(TArray<uint8>& OutData) const
+{
+	check(OwnedBatteriesCount <= 32);
+
+	OutData.Reset();
+	FMemoryWriter Ar(OutData);
+
+	uint8 Version = SnapshotVersion;
+	uint8 NumSlots = OwnedBatteries.Num();
+	uint8 CurrentIndex = CurrentBatteryIndex;
+	uint32 ChargeBits = 0;
+
+	Ar << Version << NumSlots << CurrentIndex;
+
+	for (int32 i = 0; i < OwnedBatteries.Num(); i++)
+	{
+		int32 TypeId = SnapshotBatteryTypes.IndexOfByKey(OwnedBatteries[i]->GetClass());
+
+		// RestoreSnapshot would reject the snapshot, so fail now rather than lose the loadout
+		if (!ensureMsgf(TypeId != INDEX_NONE && TypeId <= MAX_uint8, TEXT("Battery type %s is missing from SnapshotBatteryTypes"), *GetNameSafe(OwnedBatteries[i]->GetClass())))
+		{
+			OutData.Reset();
+			return false;
+		}
+
+		uint8 TypeIdByte = TypeId;
+		Ar << TypeIdByte;
+
+		if (OwnedBatteries[i]->HasCharge())
+		{
+			ChargeBits |= 1u << i;
+		}
+	}
+
+	Ar << ChargeBits;
+
+	return true;
+}
+
+bool ABackpack::RestoreSnapshot(const TArray<uint8>& Data)
+{
+	FMemoryReader Ar(Data);
+
+	uint8 Version = 0;
+	uint8 NumSlots = 0;
+	uint8 CurrentIndex = 0;
+	uint32 ChargeBits = 0;
+
+	Ar << Version << NumSlots << CurrentIndex;
+
+	if (Ar.IsError() || Version != SnapshotVersion || NumSlots != OwnedBatteriesCount || NumSlots != OwnedBatteries.Num() || CurrentIndex >= NumSlots)
+	{
+		return false;
+	}
+
+	uint8 TypeIds[32];
+
+	for (int32 i = 0; i < NumSlots; i++)
+	{
+		Ar << TypeIds[i];
+
+		if (!SnapshotBatteryTypes.IsValidIndex(TypeIds[i]) || !SnapshotBatteryTypes[TypeIds[i]])
+		{
+			return false;
+		}
+	}
+
+	Ar << ChargeBits;
+
+	if (Ar.IsError())
+	{
+		return false;
+	}
+
+
+	// A rechamber or reload still pending would advance the restored index or recharge the restored batteries
+	FTimerManager& TimerManager = GetWorldTimerManager();
+	TimerManager.ClearTimer(RechamberTimer);
+	TimerManager.ClearTimer(ReloadTimer);
+
+	// Set the index first so that replacing batteries does not broadcast for the wrong slot
+	CurrentBatteryIndex = CurrentIndex;
+
+	for (int32 i = 0; i < NumSlots; i++)
+	{
+		TSubclassOf<ABattery> BatteryType = SnapshotBatteryTypes[TypeIds[i]];
+
+		if (OwnedBatteries[i]->GetClass() != BatteryType)
+		{
+			InsertNewBattery(BatteryType, i);
+		}
+
+		OwnedBatteries[i]->SetChargeImmediate((ChargeBits & (1u << i)) != 0);
+	}
+
+	if (CurrentBatteryChangedEvent.IsBound())
+	{
+		CurrentBatteryChangedEvent.Broadcast();
+	}
+
+	checkCode(CheckInvariants());
+
+	return true;
+}
+
+
 #pragma region === Accessors ===
 
 const ABattery* ABackpack::GetCurrentBattery() const
@@ -173,6 +397,11 @@ const ABattery* ABackpack::GetBatteryAtIndex(int32 Index) const
 	return OwnedBatteries[Index];
 }
 
+bool ABackpack::AreVisualsSignificant() const
+{
+	return bVisualsSignificant;
+}
+
 int32 ABackpack::GetCurrentBatteryIndex() const
 {
 	return CurrentBatteryIndex;
@@ -190,6 +419,40 @@ int32 ABackpack::GetNextBatteryIndex() const
 	return NextBatteryIndex;
 }
 
+bool ABackpack::CheckInvariants() const
+{
+	bool bValid = true;
+
+	bValid &= ensureMsgf(OwnedBatteries.Num() == OwnedBatteriesCount, TEXT("Backpack has %d batteries, expected %d"), OwnedBatteries.Num(), OwnedBatteriesCount);
+	bValid &= ensureMsgf(OwnedBatteries.IsValidIndex(CurrentBatteryIndex), TEXT("Current battery index %d out of range"), CurrentBatteryIndex);
+
+	TMap<FGameplayTag, int32> ActualTypeCounts;
+
+	for (const ABattery* Battery : OwnedBatteries)
+	{
+		if (!ensureMsgf(Battery, TEXT("Backpack has a null battery")))
+		{
+			return false;
+		}
+
+		ActualTypeCounts.FindOrAdd(Battery->GetBatteryTypeTag())++;
+	}
+
+	for (const TPair<FGameplayTag, int32>& TypeCount : BatteryTypeCounts)
+	{
+		const int32* ActualCount = ActualTypeCounts.Find(TypeCount.Key);
+
+		bValid &= ensureMsgf((ActualCount ? *ActualCount : 0) == TypeCount.Value, TEXT("Battery type count of %s is %d, but backpack has %d"), *TypeCount.Key.ToString(), TypeCount.Value, ActualCount ? *ActualCount : 0);
+	}
+
+	for (const TPair<FGameplayTag, int32>& TypeCount : ActualTypeCounts)
+	{
+		bValid &= ensureMsgf(BatteryTypeCounts.Contains(TypeCount.Key), TEXT("Battery type %s is not counted"), *TypeCount.Key.ToString());
+	}
+
+	return bValid;
+}
+
 const int32 ABackpack::GetCurrentBatteryCount() const
 {
 	const ABattery* CurrentBattery = GetCurrentBattery();
@@ -203,6 +466,61 @@ const int32 ABackpack::GetCurrentBatteryCount() const
 #pragma endregion
 
 
+#pragma region === Thread Safe Accessors ===
+
+void ABackpack::ReadView(FBackpackView& OutView) const
+{
+	uint32 Sequence = ViewSequence.load(std::memory_order_acquire);
+
+	while (true)
+	{
+		OutView = Views[Sequence & 1];
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		const uint32 SequenceAfterCopy = ViewSequence.load(std::memory_order_relaxed);
+
+		if (SequenceAfterCopy == Sequence)
+		{
+			return;
+		}
+
+		Sequence = SequenceAfterCopy;
+	}
+}
+
+FBackpackSlotView ABackpack::GetSlotView_ThreadSafe(int32 Index) const
+{
+	FBackpackView View;
+	ReadView(View);
+
+	if (Index < 0 || Index >= View.NumSlots)
+	{
+		return FBackpackSlotView();
+	}
+
+	return View.Slots[Index];
+}
+
+int32 ABackpack::GetCurrentBatteryIndex_ThreadSafe() const
+{
+	FBackpackView View;
+	ReadView(View);
+
+	return View.CurrentBatteryIndex;
+}
+
+int32 ABackpack::GetNextBatteryIndex_ThreadSafe() const
+{
+	FBackpackView View;
+	ReadView(View);
+
+	return View.NextBatteryIndex;
+}
+
+#pragma endregion
+
+
 void ABackpack::CreateInitialBatteries()
 {
 	check(OwnedBatteriesCount > 0);
@@ -217,14 +535,19 @@ void ABackpack::CreateInitialBatteries()
 	{
 		check(InitialOwnedBatteryTypes[i]);
 
+		BakeBatteryType(InitialOwnedBatteryTypes[i]);
+
 		if (OwnedBatteries[i] != nullptr)
 		{
 			OwnedBatteries[i]->Destroy();
 		}
 
-		OwnedBatteries[i] = Cast<ABattery>(World->SpawnActor(InitialOwnedBatteryTypes[i]));
+		{
+			LLM_SCOPE_BYTAG(PU_Batteries);
+			OwnedBatteries[i] = Cast<ABattery>(World->SpawnActor(InitialOwnedBatteryTypes[i]));
+		}
 
-		AttachBatteryToSocket(OwnedBatteries[i], i);
+		AttachBattery(OwnedBatteries[i], i);
 	}
 
 	if (CurrentBatteryChangedEvent.IsBound())
@@ -233,6 +556,18 @@ void ABackpack::CreateInitialBatteries()
 	}
 }
 
+void ABackpack::AttachBattery(ABattery* Battery, int32 SocketIndex)
+{
+	// Without the mesh there are no sockets, so the battery only follows the backpack
+	if (BackpackMesh == nullptr)
+	{
+		Battery->AttachToActor(this, FAttachmentTransformRules::SnapToTargetNotIncludingScale);
+		return;
+	}
+
+	AttachBatteryToSocket(Battery, SocketIndex);
+}
+
 void ABackpack::CountBatteryTypes()
 {
 	BatteryTypeCounts.Empty();
@@ -259,17 +594,165 @@ void ABackpack::CountBatteryTypes()
 	}
 }
 
+void ABackpack::BakeBatteryType(TSubclassOf<ABattery> BatteryClass) const
+{
+	// The discharge level is the count of the battery type, so it can't exceed the number of batteries
+	ABattery::BakeDischargeParameters(BatteryClass, OwnedBatteriesCount);
+}
+
 void ABackpack::ActivateReloadAbility()
 {
+	LLM_SCOPE_BYTAG(PU_Backpack);
+
+	// GiveAbilityAndActivateOnce rejects non-instanced abilities, which have to be granted and activated instead
+	if (!ensureMsgf(ReloadAbility && ReloadAbility.GetDefaultObject()->GetInstancingPolicy() != EGameplayAbilityInstancingPolicy::NonInstanced,
+		TEXT("Reload ability %s is missing or non-instanced"), *GetNameSafe(ReloadAbility)))
+	{
+		return;
+	}
+
 	FGameplayAbilitySpec AbilitySpec = FGameplayAbilitySpec(ReloadAbility);
 
 	OwnerASC->GiveAbilityAndActivateOnce(AbilitySpec);
+	FBackpackMemoryTracker::CountTransientAbilitySpec();
+}
+
+void ABackpack::CallAfterDuration(FTimerHandle& Timer, void (ABackpack::*Function)(), float Duration)
+{
+	if (Duration <= 0.f)
+	{
+		(this->*Function)();
+		return;
+	}
+
+	GetWorldTimerManager().SetTimer(Timer, this, Function, Duration, false);
+}
+
+void ABackpack::FlushPendingCalls()
+{
+	FTimerManager& TimerManager = GetWorldTimerManager();
+
+	if (TimerManager.IsTimerActive(RechamberTimer))
+	{
+		TimerManager.ClearTimer(RechamberTimer);
+		Rechamber_CPP();
+	}
+
+	if (TimerManager.IsTimerActive(ReloadTimer))
+	{
+		TimerManager.ClearTimer(ReloadTimer);
+		Reload_CPP();
+	}
 }
 
 void ABackpack::UpdateEmissiveMaterial()
 {
+	if (!bVisualsSignificant)
+	{
+		return;
+	}
+
 	const ABattery* CurrentBattery = GetCurrentBattery();
 	check(CurrentBattery);
 
 	BackpackMesh->SetMaterial(EmissiveMaterialSlot, CurrentBattery->GetActiveMaterial());
 }
+
+void ABackpack::MarkViewDirty()
+{
+	SetActorTickEnabled(true);
+}
+
+void ABackpack::PublishView()
+{
+	const uint32 Sequence = ViewSequence.load(std::memory_order_relaxed);
+
+	// Orders the previous publish before the writes below, so readers of this buffer see the sequence change
+	std::atomic_thread_fence(std::memory_order_release);
+
+	FBackpackView& View = Views[(Sequence + 1) & 1];
+
+	View.NumSlots = OwnedBatteries.Num();
+	View.CurrentBatteryIndex = CurrentBatteryIndex;
+	View.NextBatteryIndex = GetNextBatteryIndex();
+
+	for (int32 i = 0; i < OwnedBatteries.Num(); i++)
+	{
+		const ABattery* Battery = OwnedBatteries[i];
+
+		View.Slots[i].BatteryTypeTag = Battery->GetBatteryTypeTag();
+		View.Slots[i].VisualsColor = Battery->GetVisualsColor();
+		View.Slots[i].bHasCharge = Battery->HasCharge();
+	}
+
+	ViewSequence.store(Sequence + 1, std::memory_order_release);
+}
+
+void ABackpack::WarmUpUpcomingBatteries()
+{
+	WarmUpBattery(GetCurrentBattery());
+	WarmUpBattery(GetBatteryAtIndex(GetNextBatteryIndex()));
+}
+
+void ABackpack::WarmUpBattery(const ABattery* Battery)
+{
+	check(IsInGameThread());
+
+	// Insignificant owners don't spawn discharge VFX, so they leave the warm up to the first significant backpack of the type
+	if (Battery == nullptr || !bVisualsSignificant)
+	{
+		return;
+	}
+
+	static const FDelegateHandle WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool)
+	{
+		WarmedBatteryTypes.Remove(World);
+	});
+
+	bool bAlreadyWarmed = false;
+	WarmedBatteryTypes.FindOrAdd(GetWorld()).Add(Battery->GetClass(), &bAlreadyWarmed);
+
+	if (bAlreadyWarmed)
+	{
+		return;
+	}
+
+	LLM_SCOPE_BYTAG(PU_DischargeVFX);
+
+	for (UNiagaraSystem* DischargeVFX : { Battery->GetDischargeBeamVFX(), Battery->GetDischargeMuzzleVFX() })
+	{
+		if (DischargeVFX == nullptr)
+		{
+			continue;
+		}
+
+		// Registering the component precaches its PSOs, and initializing creates the system instance without playing it.
+		// Releasing to the pool leaves it ready for the discharge to reuse.
+		UNiagaraComponent* VFXComponent = UNiagaraFunctionLibrary::SpawnSystemAtLocation(
+			this, DischargeVFX, GetActorLocation(), FRotator::ZeroRotator, FVector::OneVector, false, false, ENCPoolMethod::ManualRelease, false);
+
+		if (VFXComponent)
+		{
+			VFXComponent->InitializeSystem();
+			VFXComponent->ReleaseToPool();
+		}
+	}
+}
+
+void ABackpack::SetVisualsSignificant(bool bSignificant)
+{
+	if (bSignificant == bVisualsSignificant || FPUVisualSignificance::AreVisualsStripped())
+	{
+		return;
+	}
+
+	bVisualsSignificant = bSignificant;
+
+	for (ABattery* Battery : OwnedBatteries)
+	{
+		Battery->SetVisualsSignificant(bSignificant);
+	}
+
+	UpdateEmissiveMaterial();
+	WarmUpUpcomingBatteries();
+}
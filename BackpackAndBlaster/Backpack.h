@@ -6,6 +6,7 @@
 #include "GameFramework/Actor.h"
 #include "ProjectUnrest/Actors/Battery.h"
 #include "GameplayTagContainer.h"
+#include <atomic>
 #include "Backpack.generated.h"
 
 
@@ -18,6 +19,35 @@ class APUBlaster;
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FCurrentBatteryChangedDelegate);
 
 
+/* A battery slot as seen from worker threads */
+USTRUCT(BlueprintType)
+struct FBackpackSlotView
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Backpack")
+	FGameplayTag BatteryTypeTag;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Backpack")
+	FLinearColor VisualsColor = FLinearColor::Black;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Backpack")
+	bool bHasCharge = false;
+};
+
+/* A plain copy of the cylinder that the backpack publishes once per frame, so it can be read without touching battery actors */
+struct FBackpackView
+{
+	static constexpr int32 MaxSlots = 8;
+
+	FBackpackSlotView Slots[MaxSlots];
+
+	int32 NumSlots = 0;
+	int32 CurrentBatteryIndex = 0;
+	int32 NextBatteryIndex = 0;
+};
+
+
 /*
 *	An actor that has and manages batteries. Uses an index to track the current battery. When the current battery is
 *	discharged, the backpack rechambers, rotating to the next battery. When the last battery is discharged, the backpack reloads, 
@@ -31,6 +61,15 @@ class PROJECTUNREST_API ABackpack : public AActor
 public:	
 	ABackpack();
 
+	/* Adds the battery type counts, which aren't reflected, to the resource size */
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	/* Unregisters from visual significance */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/* Only enabled for the frame after the current battery changes, to publish the view */
+	virtual void Tick(float DeltaSeconds) override;
+
 	/* Event fired when the current battery changes, whether it is a new one or just recharged/discharged */
 	FCurrentBatteryChangedDelegate CurrentBatteryChangedEvent;
 
@@ -43,12 +82,13 @@ public:
 
 	/* 
 	*	The calling function for rechamber functionality. Decides whether to reload or increment current battery index.
-	*	Defers the visual changes to Rechamber_BP.
+	*	Defers the visual changes to Rechamber_BP, unless visuals are not significant, in which case it calls Rechamber_CPP after
+	*	RechamberDuration. A rechamber still pending from the last call is finished first.
 	*/
 	UFUNCTION(BlueprintCallable, Category = "Backpack")
 	void Rechamber_Exec();
 
-	/* The calling function for the reload functionality. */
+	/* The calling function for the reload functionality. If visuals are not significant, skips Reload_BP and calls Reload_CPP after ReloadDuration. */
 	UFUNCTION(BlueprintCallable, Category = "Backpack")
 	void Reload_Exec();
 
@@ -65,6 +105,22 @@ public:
 	void DischargeCurrentBattery();
 
 
+	/* 
+	*	Writes a compact versioned snapshot of the battery types, charges, and current index, used to carry the loadout between rooms.
+	*	Returns false, leaving OutData empty, if a battery type is missing from SnapshotBatteryTypes.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	bool SaveSnapshot(TArray<uint8>& OutData) const;
+
+	/* 
+	*	Restores a snapshot made by SaveSnapshot. Only respawns batteries whose type differs from the snapshot, and skips the
+	*	recharge/discharge animations. A rechamber or reload pending without visuals is dropped. Returns false without changing
+	*	anything if the snapshot is invalid.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	bool RestoreSnapshot(const TArray<uint8>& Data);
+
+
 	#pragma region === Accessors ===
 
 	/* Returns the next battery to be shot */
@@ -85,15 +141,43 @@ public:
 	int32 GetNextBatteryIndex() const;
 
 
+	/* Returns whether the owner is significant enough to update visuals, e.g. close to and visible from a viewpoint */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	bool AreVisualsSignificant() const;
+
 	/* Returns the count of the current battery type */
 	UFUNCTION(BlueprintCallable, Category = "Backpack")
 	const int32 GetCurrentBatteryCount() const;
 
+	/* Returns whether the battery counts match the batteries and the current index is in range. Ensures on each violation. */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	bool CheckInvariants() const;
+
+	#pragma endregion
+
+
+	#pragma region === Thread Safe Accessors ===
+
+	/* Copies the latest published view of the cylinder. Lock-free and safe to call from any thread, e.g. anim worker threads. */
+	void ReadView(FBackpackView& OutView) const;
+
+	/* Returns the slot at the given index from the latest published view */
+	UFUNCTION(BlueprintPure, Category = "Backpack", meta = (BlueprintThreadSafe))
+	FBackpackSlotView GetSlotView_ThreadSafe(int32 Index) const;
+
+	/* Returns the index of the next battery to be shot from the latest published view */
+	UFUNCTION(BlueprintPure, Category = "Backpack", meta = (BlueprintThreadSafe))
+	int32 GetCurrentBatteryIndex_ThreadSafe() const;
+
+	/* Returns the battery after the current battery from the latest published view */
+	UFUNCTION(BlueprintPure, Category = "Backpack", meta = (BlueprintThreadSafe))
+	int32 GetNextBatteryIndex_ThreadSafe() const;
+
 	#pragma endregion
 
 
 protected:
-	/* The blaster's static mesh */
+	/* The backpack's static mesh. Not created on dedicated servers, where it is null and a plain scene component is the root. */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Backpack")
 	UStaticMeshComponent* BackpackMesh = nullptr;
 
@@ -101,7 +185,31 @@ protected:
 	UPROPERTY(BlueprintReadOnly, Category = "Backpack")
 	TArray<ABattery*> OwnedBatteries;
 
-	/* Sets battery location to socket and attaches to it */
+	/* Total number of batteries per cylinder (reload) */
+	UPROPERTY(EditDefaultsOnly, Category = "Backpack")
+	int32 OwnedBatteriesCount = 6;
+
+	/* The types of batteries the backpack starts with */
+	UPROPERTY(EditDefaultsOnly, Category = "Backpack")
+	TArray<TSubclassOf<ABattery>> InitialOwnedBatteryTypes;
+
+	/* The gameplay ability that drives the backpack reload */
+	UPROPERTY(EditDefaultsOnly, Category = "Backpack")
+	TSubclassOf<UPUGameplayAbility> ReloadAbility;
+
+	/* How long Rechamber_BP takes to call Rechamber_CPP. Used instead of the animation while visuals are not significant. */
+	UPROPERTY(EditDefaultsOnly, Category = "Backpack", meta = (ClampMin = "0", Units = "s"))
+	float RechamberDuration = 0.f;
+
+	/* How long Reload_BP takes to call Reload_CPP. Used instead of the animation while visuals are not significant. */
+	UPROPERTY(EditDefaultsOnly, Category = "Backpack", meta = (ClampMin = "0", Units = "s"))
+	float ReloadDuration = 0.f;
+
+	/* Every battery type that can be saved in a snapshot. A type's index in this array is its ID in the snapshot, so only append to it. */
+	UPROPERTY(EditDefaultsOnly, Category = "Backpack")
+	TArray<TSubclassOf<ABattery>> SnapshotBatteryTypes;
+
+	/* Sets battery location to socket and attaches to it. Not called without BackpackMesh, e.g. on dedicated servers. */
 	UFUNCTION(BlueprintImplementableEvent, Category = "Backpack")
 	void AttachBatteryToSocket(ABattery* Battery, int32 SocketIndex);
 
@@ -121,19 +229,13 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Backpack")
 	void Reload_CPP();
 
+	/* Skips or restores the visuals of the backpack and its batteries, applying their current state when restored */
+	void SetVisualsSignificant(bool bSignificant);
 
-private:
-	/* Total number of batteries per cylinder (reload) */
-	UPROPERTY(EditDefaultsOnly, Category = "Backpack", meta = (AllowPrivateAccess = "true"))
-	int32 OwnedBatteriesCount = 6;
-
-	/* The types of batteries the backpack starts with */
-	UPROPERTY(EditDefaultsOnly, Category = "Backpack", meta = (AllowPrivateAccess = "true"))
-	TArray<TSubclassOf<ABattery>> InitialOwnedBatteryTypes;
 
-	/* The gameplay ability that drives the backpack reload */
-	UPROPERTY(EditDefaultsOnly, Category = "Backpack", meta = (AllowPrivateAccess = "true"))
-	TSubclassOf<UPUGameplayAbility> ReloadAbility;
+private:
+	/* Incremented whenever the snapshot layout changes */
+	static constexpr uint8 SnapshotVersion = 1;
 
 
 	/* The character that owns (i.e., inits) this backpack */
@@ -151,17 +253,56 @@ private:
 	/* The material slot index for the emissive material of BackpackMesh*/
 	int32 EmissiveMaterialSlot = 0;
 
+	/* Whether the owner is significant enough to update visuals. Emissive updates and animations are skipped while false. */
+	bool bVisualsSignificant = true;
+
+	/* Calls Rechamber_CPP or Reload_CPP after their duration while visuals are not significant */
+	FTimerHandle RechamberTimer;
+	FTimerHandle ReloadTimer;
+
+	/* Double buffered views of the cylinder. The published view is Views[ViewSequence & 1]. */
+	FBackpackView Views[2];
+
+	/* Incremented when a view is published. Readers retry if it changes while they copy, since the next publish overwrites their buffer. */
+	std::atomic<uint32> ViewSequence { 0 };
+
 
 	/* Creates initial battery instances from specified initial classes */
 	void CreateInitialBatteries();
 
+	/* Attaches the battery to its socket with AttachBatteryToSocket, or to the backpack root if there is no mesh */
+	void AttachBattery(ABattery* Battery, int32 SocketIndex);
+
 	/* Counts the number of each type of battery in the cylinder, storing the counts in a TMap */
 	void CountBatteryTypes();
 
+	/* Bakes the discharge parameters of the given battery type for every level it can be discharged at */
+	void BakeBatteryType(TSubclassOf<ABattery> BatteryClass) const;
+
 	/* Gives and activates the reload ability to the OwnerASC */
 	void ActivateReloadAbility();
 
+	/* Calls the function after the duration, or now if the duration is zero */
+	void CallAfterDuration(FTimerHandle& Timer, void (ABackpack::*Function)(), float Duration);
+
+	/* Makes a Rechamber_CPP or Reload_CPP call still pending on its timer now, rather than dropping it */
+	void FlushPendingCalls();
+
 	/* Sets the backpack's emissive material to that of the current battery */
 	UFUNCTION()
 	void UpdateEmissiveMaterial();
+
+	/* Enables tick for one frame, so that however many times the current battery changes, the view is published once */
+	UFUNCTION()
+	void MarkViewDirty();
+
+	/* Writes the cylinder into the unpublished view, then publishes it */
+	void PublishView();
+
+	/* Warms up the current and next battery, so the first discharge of their type doesn't hitch */
+	UFUNCTION()
+	void WarmUpUpcomingBatteries();
+
+	/* Initializes and pools the battery type's VFX systems, once per type and world. Skipped while visuals are not significant. */
+	void WarmUpBattery(const ABattery* Battery);
 };
@@ -0,0 +1,339 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ProjectUnrest/Actors/ShootLoopTestFixture.h"
+#include "ProjectUnrest/Actors/ShootLoopTestTypes.h"
+#include "ProjectUnrest/Actors/Backpack.h"
+#include "ProjectUnrest/Actors/Battery.h"
+#include "ProjectUnrest/Actors/PUBlaster.h"
+
+
+BEGIN_DEFINE_SPEC(FPUBackpackSpec, "ProjectUnrest.Backpack", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	FPUShootLoopTestWorld TestWorld;
+
+	FPUTestShooter Shooter;
+
+	/* Discharges the current battery and waits for the rechamber, or the reload after the last battery, to finish */
+	bool FireAndRechamber();
+
+END_DEFINE_SPEC(FPUBackpackSpec)
+
+
+bool FPUBackpackSpec::FireAndRechamber()
+{
+	const int32 NextIndex = Shooter.Backpack->GetNextBatteryIndex();
+
+	Shooter.Blaster->Discharge(FHitResult());
+	Shooter.Backpack->Rechamber_Exec();
+
+	return TestWorld.TickUntil([this, NextIndex]() { return Shooter.Backpack->GetCurrentBatteryIndex() == NextIndex; }, 5.f);
+}
+
+
+void FPUBackpackSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		TestWorld.Create();
+
+		// Rechamber_BP and Reload_BP are only implemented in blueprints, so only an insignificant shooter rechambers natively
+		Shooter = TestWorld.SpawnShooter(false);
+	});
+
+	AfterEach([this]()
+	{
+		TestWorld.Destroy();
+	});
+
+
+	Describe("Cylinder", [this]()
+	{
+		It("should discharge each battery in order and rechamber to the next", [this]()
+		{
+			for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack - 1; i++)
+			{
+				const ABattery* FiredBattery = Shooter.Backpack->GetCurrentBattery();
+
+				if (!TestTrue(FString::Printf(TEXT("Rechambered after shot %d"), i), FireAndRechamber()))
+				{
+					return;
+				}
+
+				TestFalse(TEXT("Fired battery has charge"), FiredBattery->HasCharge());
+				TestEqual(TEXT("Current battery index"), Shooter.Backpack->GetCurrentBatteryIndex(), i + 1);
+				TestTrue(TEXT("Current battery has charge"), Shooter.Backpack->GetCurrentBattery()->HasCharge());
+			}
+
+			TestTrue(TEXT("Invariants hold"), Shooter.Backpack->CheckInvariants());
+		});
+
+		It("should reload and recharge every battery after the last battery is discharged", [this]()
+		{
+			for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack; i++)
+			{
+				if (!TestTrue(FString::Printf(TEXT("Rechambered after shot %d"), i), FireAndRechamber()))
+				{
+					return;
+				}
+			}
+
+			TestEqual(TEXT("Current battery index"), Shooter.Backpack->GetCurrentBatteryIndex(), 0);
+
+			for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack; i++)
+			{
+				TestTrue(FString::Printf(TEXT("Battery %d has charge"), i), Shooter.Backpack->GetBatteryAtIndex(i)->HasCharge());
+			}
+
+			TestTrue(TEXT("Invariants hold"), Shooter.Backpack->CheckInvariants());
+		});
+
+		It("should take as long to rechamber and reload without visuals", [this]()
+		{
+			const float TickDelta = 1.f / 60.f;
+
+			for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack; i++)
+			{
+				const int32 NextIndex = Shooter.Backpack->GetNextBatteryIndex();
+				const bool bReloads = NextIndex == 0;
+
+				Shooter.Blaster->Discharge(FHitResult());
+				Shooter.Backpack->Rechamber_Exec();
+
+				TestNotEqual(FString::Printf(TEXT("Index changed instantly on shot %d"), i), Shooter.Backpack->GetCurrentBatteryIndex(), NextIndex);
+
+				const double StartTime = TestWorld.GetWorld()->GetTimeSeconds();
+
+				if (!TestTrue(FString::Printf(TEXT("Rechambered after shot %d"), i),
+					TestWorld.TickUntil([this, NextIndex]() { return Shooter.Backpack->GetCurrentBatteryIndex() == NextIndex; }, 5.f, TickDelta)))
+				{
+					return;
+				}
+
+				const double Duration = TestWorld.GetWorld()->GetTimeSeconds() - StartTime;
+				const float ExpectedDuration = bReloads ? FPUShootLoopTestWorld::ReloadDuration : FPUShootLoopTestWorld::RechamberDuration;
+
+				TestTrue(FString::Printf(TEXT("Shot %d took %.3fs, expected %.3fs"), i, Duration, ExpectedDuration),
+					Duration >= ExpectedDuration - UE_KINDA_SMALL_NUMBER && Duration <= ExpectedDuration + TickDelta + UE_KINDA_SMALL_NUMBER);
+			}
+		});
+
+		It("should reload instead of overrunning the cylinder when fired twice within a rechamber on the second to last battery", [this]()
+		{
+			const int32 LastIndex = FPUShootLoopTestWorld::BatteriesPerBackpack - 1;
+
+			while (Shooter.Backpack->GetCurrentBatteryIndex() < LastIndex - 1)
+			{
+				if (!TestTrue(TEXT("Rechambered"), FireAndRechamber()))
+				{
+					return;
+				}
+			}
+
+			Shooter.Blaster->Discharge(FHitResult());
+			Shooter.Backpack->Rechamber_Exec();
+
+			// The first rechamber is still pending, so this one has to finish it before deciding to reload
+			TestWorld.Tick(FPUShootLoopTestWorld::RechamberDuration / 2.f);
+			Shooter.Backpack->Rechamber_Exec();
+
+			TestEqual(TEXT("Current battery index after the second rechamber"), Shooter.Backpack->GetCurrentBatteryIndex(), LastIndex);
+			TestTrue(TEXT("Invariants hold after the second rechamber"), Shooter.Backpack->CheckInvariants());
+
+			TestTrue(TEXT("Reloaded"), TestWorld.TickUntil([this]() { return Shooter.Backpack->GetCurrentBatteryIndex() == 0; }, FPUShootLoopTestWorld::ReloadDuration * 2.f));
+
+			for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack; i++)
+			{
+				TestTrue(FString::Printf(TEXT("Battery %d has charge"), i), Shooter.Backpack->GetBatteryAtIndex(i)->HasCharge());
+			}
+
+			TestTrue(TEXT("Invariants hold after the reload"), Shooter.Backpack->CheckInvariants());
+		});
+
+		It("should keep cycling through several reloads", [this]()
+		{
+			for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack * 4; i++)
+			{
+				if (!TestTrue(FString::Printf(TEXT("Rechambered after shot %d"), i), FireAndRechamber()))
+				{
+					return;
+				}
+			}
+
+			TestEqual(TEXT("Current battery index"), Shooter.Backpack->GetCurrentBatteryIndex(), 0);
+			TestTrue(TEXT("Invariants hold"), Shooter.Backpack->CheckInvariants());
+		});
+	});
+
+
+	Describe("Battery changes", [this]()
+	{
+		It("should count the new type when a battery is inserted", [this]()
+		{
+			int32 GreenCount = 0;
+
+			for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack; i++)
+			{
+				GreenCount += Shooter.Backpack->GetBatteryAtIndex(i)->GetBatteryTypeTag() == TAG_PU_Test_Battery_Green ? 1 : 0;
+			}
+
+			// Slot 0 holds a red battery, and is the current one
+			Shooter.Backpack->InsertNewBattery(FPUShootLoopTestWorld::GetBatteryTypes()[1], 0);
+
+			TestTrue(TEXT("Current battery is green"), Shooter.Backpack->GetCurrentBattery()->GetBatteryTypeTag() == TAG_PU_Test_Battery_Green);
+			TestEqual(TEXT("Green count"), Shooter.Backpack->GetCurrentBatteryCount(), GreenCount + 1);
+
+			// Checks every count against the batteries, so covers the red count going down
+			TestTrue(TEXT("Invariants hold"), Shooter.Backpack->CheckInvariants());
+		});
+
+		It("should publish inserts and swaps of batteries other than the current one", [this]()
+		{
+			const TArray<TSubclassOf<ABattery>>& BatteryTypes = FPUShootLoopTestWorld::GetBatteryTypes();
+			const int32 FirstIndex = 1;
+			const int32 SecondIndex = 2;
+
+			// Inserts a type the slot doesn't hold, so the view has to change
+			const FGameplayTag OldTag = Shooter.Backpack->GetBatteryAtIndex(SecondIndex)->GetBatteryTypeTag();
+			TSubclassOf<ABattery> NewBatteryClass = BatteryTypes[0];
+
+			for (const TSubclassOf<ABattery>& BatteryClass : BatteryTypes)
+			{
+				if (BatteryClass->GetDefaultObject<ABattery>()->GetBatteryTypeTag() != OldTag)
+				{
+					NewBatteryClass = BatteryClass;
+					break;
+				}
+			}
+
+			TestWorld.Tick(1.f / 60.f);
+
+			Shooter.Backpack->InsertNewBattery(NewBatteryClass, SecondIndex);
+			TestWorld.Tick(1.f / 60.f);
+
+			const FGameplayTag NewTag = Shooter.Backpack->GetBatteryAtIndex(SecondIndex)->GetBatteryTypeTag();
+			TestTrue(TEXT("Inserted battery published"), Shooter.Backpack->GetSlotView_ThreadSafe(SecondIndex).BatteryTypeTag == NewTag);
+
+			const FGameplayTag FirstTag = Shooter.Backpack->GetBatteryAtIndex(FirstIndex)->GetBatteryTypeTag();
+
+			Shooter.Backpack->SwapOwnedBatteries(FirstIndex, SecondIndex);
+			TestWorld.Tick(1.f / 60.f);
+
+			TestTrue(TEXT("First swapped battery published"), Shooter.Backpack->GetSlotView_ThreadSafe(FirstIndex).BatteryTypeTag == NewTag);
+			TestTrue(TEXT("Second swapped battery published"), Shooter.Backpack->GetSlotView_ThreadSafe(SecondIndex).BatteryTypeTag == FirstTag);
+		});
+
+		It("should keep the invariants through random inserts, swaps and rechambers", [this]()
+		{
+			const int32 Seed = FMath::Rand();
+			FRandomStream Random(Seed);
+
+			AddInfo(FString::Printf(TEXT("Fuzz seed: %d"), Seed));
+
+			const TArray<TSubclassOf<ABattery>>& BatteryTypes = FPUShootLoopTestWorld::GetBatteryTypes();
+			const int32 LastIndex = FPUShootLoopTestWorld::BatteriesPerBackpack - 1;
+
+			for (int32 Step = 0; Step < 2000; Step++)
+			{
+				switch (Random.RandRange(0, 2))
+				{
+				case 0:
+					Shooter.Backpack->InsertNewBattery(BatteryTypes[Random.RandRange(0, BatteryTypes.Num() - 1)], Random.RandRange(0, LastIndex));
+					break;
+
+				case 1:
+					Shooter.Backpack->SwapOwnedBatteries(Random.RandRange(0, LastIndex), Random.RandRange(0, LastIndex));
+					break;
+
+				default:
+					// Reloading needs the reload ability, so the cylinder is reset directly at the last battery
+					if (Shooter.Backpack->GetCurrentBatteryIndex() < LastIndex)
+					{
+						Shooter.Backpack->CompleteRechamber();
+					}
+					else
+					{
+						Shooter.Backpack->CompleteReload();
+					}
+					break;
+				}
+
+				if (!TestTrue(FString::Printf(TEXT("Invariants hold after step %d (seed %d)"), Step, Seed), Shooter.Backpack->CheckInvariants()))
+				{
+					return;
+				}
+			}
+		});
+	});
+
+	Describe("Snapshot", [this]()
+	{
+		It("should restore the loadout, charges and current battery", [this]()
+		{
+			const TArray<TSubclassOf<ABattery>>& BatteryTypes = FPUShootLoopTestWorld::GetBatteryTypes();
+			// Slot 4 holds a green battery
+			const int32 ChangedIndex = 4;
+
+			FireAndRechamber();
+			FireAndRechamber();
+			Shooter.Backpack->InsertNewBattery(BatteryTypes[2], ChangedIndex);
+
+			TArray<FGameplayTag> SavedTags;
+			TArray<bool> SavedCharges;
+
+			for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack; i++)
+			{
+				SavedTags.Add(Shooter.Backpack->GetBatteryAtIndex(i)->GetBatteryTypeTag());
+				SavedCharges.Add(Shooter.Backpack->GetBatteryAtIndex(i)->HasCharge());
+			}
+
+			const int32 SavedIndex = Shooter.Backpack->GetCurrentBatteryIndex();
+
+			TArray<uint8> Snapshot;
+
+			if (!TestTrue(TEXT("Saved snapshot"), Shooter.Backpack->SaveSnapshot(Snapshot)))
+			{
+				return;
+			}
+
+			// Change every part of the state the snapshot covers
+			FireAndRechamber();
+			Shooter.Backpack->InsertNewBattery(BatteryTypes[0], ChangedIndex);
+			Shooter.Backpack->SwapOwnedBatteries(0, 1);
+
+			TestTrue(TEXT("Restored snapshot"), Shooter.Backpack->RestoreSnapshot(Snapshot));
+			TestEqual(TEXT("Current battery index"), Shooter.Backpack->GetCurrentBatteryIndex(), SavedIndex);
+
+			for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack; i++)
+			{
+				TestTrue(FString::Printf(TEXT("Battery %d type"), i), Shooter.Backpack->GetBatteryAtIndex(i)->GetBatteryTypeTag() == SavedTags[i]);
+				TestEqual(FString::Printf(TEXT("Battery %d charge"), i), Shooter.Backpack->GetBatteryAtIndex(i)->HasCharge(), SavedCharges[i]);
+			}
+
+			TestTrue(TEXT("Invariants hold"), Shooter.Backpack->CheckInvariants());
+		});
+
+		It("should drop a rechamber that was pending when restoring", [this]()
+		{
+			TArray<uint8> Snapshot;
+			Shooter.Backpack->SaveSnapshot(Snapshot);
+
+			Shooter.Blaster->Discharge(FHitResult());
+			Shooter.Backpack->Rechamber_Exec();
+
+			TestTrue(TEXT("Restored snapshot"), Shooter.Backpack->RestoreSnapshot(Snapshot));
+
+			TestWorld.Tick(FPUShootLoopTestWorld::RechamberDuration * 2.f);
+
+			TestEqual(TEXT("Current battery index"), Shooter.Backpack->GetCurrentBatteryIndex(), 0);
+			TestTrue(TEXT("Current battery has charge"), Shooter.Backpack->GetCurrentBattery()->HasCharge());
+			TestTrue(TEXT("Invariants hold"), Shooter.Backpack->CheckInvariants());
+		});
+	});
+}
+
+#endif
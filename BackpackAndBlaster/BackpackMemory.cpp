@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectUnrest/Actors/BackpackMemory.h"
+#include "ProjectUnrest/Actors/Backpack.h"
+#include "ProjectUnrest/Actors/Battery.h"
+#include "ProjectUnrest/Actors/PUBlaster.h"
+#include "EngineUtils.h"
+#include "CoreGlobals.h"
+#include "HAL/IConsoleManager.h"
+#include "Serialization/ArchiveCountMem.h"
+#include <atomic>
+
+
+LLM_DEFINE_TAG(PU_Backpack);
+LLM_DEFINE_TAG(PU_Batteries);
+LLM_DEFINE_TAG(PU_Blaster);
+LLM_DEFINE_TAG(PU_DischargeVFX);
+LLM_DEFINE_TAG(PU_Recharger);
+
+
+namespace
+{
+	std::atomic<int64> TransientEffectCount { 0 };
+	std::atomic<int64> TransientAbilitySpecCount { 0 };
+
+	/*
+	 *	Platform time of the last report, which churn is measured from. Zero until the first report, which measures from engine start
+	 *	instead, since platform time isn't initialized yet when static variables are.
+	 */
+	double LastReportTime = 0.0;
+
+
+	/* The object's own size, its serialized containers, and any resources it reports */
+	SIZE_T GetObjectFootprint(const UObject* Object)
+	{
+		FArchiveCountMem CountMem(const_cast<UObject*>(Object));
+
+		return Object->GetClass()->GetStructureSize() + CountMem.GetMax() + Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	}
+
+	double ToKB(SIZE_T Bytes)
+	{
+		return Bytes / 1024.0;
+	}
+
+
+	void ReportMemory(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		if (World == nullptr)
+		{
+			return;
+		}
+
+		// Assets are shared between instances, so they are reported once rather than per backpack
+		TSet<const UObject*> SharedAssets;
+
+		for (TActorIterator<ABackpack> It(World); It; ++It)
+		{
+			const ABackpack* Backpack = *It;
+
+			SIZE_T BatteriesBytes = 0;
+			int32 NumBatteries = 0;
+
+			for (const ABattery* Battery = Backpack->GetBatteryAtIndex(0); Battery; Battery = Backpack->GetBatteryAtIndex(++NumBatteries))
+			{
+				BatteriesBytes += FBackpackMemoryTracker::GetActorFootprint(Battery);
+				Battery->GetVisualAssets(SharedAssets);
+			}
+
+			const SIZE_T BackpackBytes = FBackpackMemoryTracker::GetActorFootprint(Backpack);
+
+			Ar.Logf(TEXT("%s (owner %s): %.1f KB total, backpack %.1f KB, %d batteries %.1f KB"),
+				*Backpack->GetName(), *GetNameSafe(Backpack->GetOwner()), ToKB(BackpackBytes + BatteriesBytes), ToKB(BackpackBytes), NumBatteries, ToKB(BatteriesBytes));
+		}
+
+		for (TActorIterator<APUBlaster> It(World); It; ++It)
+		{
+			Ar.Logf(TEXT("%s (owner %s): %.1f KB"), *It->GetName(), *GetNameSafe(It->GetOwner()), ToKB(FBackpackMemoryTracker::GetActorFootprint(*It)));
+		}
+
+		SIZE_T SharedAssetsBytes = 0;
+
+		for (const UObject* Asset : SharedAssets)
+		{
+			SharedAssetsBytes += Asset->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+		}
+
+		Ar.Logf(TEXT("Shared battery assets: %d, %.1f KB"), SharedAssets.Num(), ToKB(SharedAssetsBytes));
+
+
+		const double Now = FPlatformTime::Seconds();
+		const double SinceTime = LastReportTime > 0.0 ? LastReportTime : GStartTime;
+		const double Minutes = FMath::Max((Now - SinceTime) / 60.0, UE_SMALL_NUMBER);
+
+		Ar.Logf(TEXT("Transient churn over %.1f min: %.1f effects/min, %.1f ability specs/min"),
+			Minutes, TransientEffectCount.exchange(0) / Minutes, TransientAbilitySpecCount.exchange(0) / Minutes);
+
+		LastReportTime = Now;
+	}
+
+
+	FAutoConsoleCommandWithWorldArgsAndOutputDevice MemReportCommand(
+		TEXT("PU.Backpack.MemReport"),
+		TEXT("Reports the memory footprint of every backpack, battery and blaster, and the transient object churn since the last report"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&ReportMemory)
+	);
+}
+
+
+void FBackpackMemoryTracker::CountTransientEffect()
+{
+	TransientEffectCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FBackpackMemoryTracker::CountTransientAbilitySpec()
+{
+	TransientAbilitySpecCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+SIZE_T FBackpackMemoryTracker::GetActorFootprint(const AActor* Actor)
+{
+	SIZE_T Bytes = GetObjectFootprint(Actor);
+
+	TInlineComponentArray<UActorComponent*> Components(Actor);
+
+	for (const UActorComponent* Component : Components)
+	{
+		Bytes += GetObjectFootprint(Component);
+	}
+
+	return Bytes;
+}
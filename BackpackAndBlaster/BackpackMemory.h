@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+
+class AActor;
+
+
+/* Low-Level Memory Tracker tags, shown as PU/Backpack, PU/Batteries, etc. */
+LLM_DECLARE_TAG_API(PU_Backpack, PROJECTUNREST_API);
+LLM_DECLARE_TAG_API(PU_Batteries, PROJECTUNREST_API);
+LLM_DECLARE_TAG_API(PU_Blaster, PROJECTUNREST_API);
+LLM_DECLARE_TAG_API(PU_DischargeVFX, PROJECTUNREST_API);
+LLM_DECLARE_TAG_API(PU_Recharger, PROJECTUNREST_API);
+
+
+/*
+ *	Counts the transient objects the shoot loop creates, so the PU.Backpack.MemReport console command can report churn per minute
+ *	alongside the footprint of each backpack, its batteries, and the blasters in the world.
+ */
+class PROJECTUNREST_API FBackpackMemoryTracker
+{
+public:
+	/* Counts a transient gameplay effect object, e.g. the charge increment effect of a recharge */
+	static void CountTransientEffect();
+
+	/* Counts an ability spec given for a single activation, e.g. a discharge or reload */
+	static void CountTransientAbilitySpec();
+
+	/* The actor's and its components' own sizes, serialized containers, and reported resources, excluding shared assets */
+	static SIZE_T GetActorFootprint(const AActor* Actor);
+};
@@ -2,14 +2,64 @@
 
 
 #include "ProjectUnrest/Actors/Battery.h"
+#include "ProjectUnrest/Actors/BackpackMemory.h"
+#include "ProjectUnrest/Actors/VisualSignificance.h"
+#include "NiagaraSystem.h"
+#include "Engine/CurveTable.h"
+#include "Engine/World.h"
+#include "UObject/ObjectKey.h"
+
+
+namespace
+{
+	/* A battery class's discharge parameters for levels 1 to MaxLevel */
+	struct FBakedDischargeParameters
+	{
+		/* The parameter tags in the order of the table's columns */
+		TArray<FGameplayTag> Tags;
+
+		/* One row per level starting at level 1 */
+		TArray<float> Values;
+
+		int32 MaxLevel = 0;
+	};
+
+	/* The baked tables by battery class. Only accessed on the game thread. */
+	TMap<TObjectKey<UClass>, FBakedDischargeParameters> BakedDischargeParameters;
+
+	/* The curve tables read by a bake, whose change delegate has been bound to drop the baked tables */
+	TSet<TObjectKey<UCurveTable>> WatchedCurveTables;
+
+	void WatchCurveTable(const UCurveTable* CurveTable)
+	{
+		if (CurveTable == nullptr || WatchedCurveTables.Contains(CurveTable))
+		{
+			return;
+		}
+
+		WatchedCurveTables.Add(CurveTable);
+
+		// Any table can feed any battery type, so a change drops them all. Tables change rarely enough that rebaking is cheap.
+		const_cast<UCurveTable*>(CurveTable)->OnCurveTableChanged().AddStatic(&ABattery::InvalidateBakedDischargeParameters);
+	}
+}
 
 
 
 ABattery::ABattery()
 {
+	LLM_SCOPE_BYTAG(PU_Batteries);
+
 	PrimaryActorTick.bCanEverTick = false;
 
-	if (!BatteryMesh)
+	bVisualsSignificant = !FPUVisualSignificance::AreVisualsStripped();
+
+	// Dedicated servers only need a transform to attach to the backpack
+	if (!bVisualsSignificant)
+	{
+		SetRootComponent(CreateDefaultSubobject<USceneComponent>(TEXT("Root")));
+	}
+	else if (!BatteryMesh)
 	{
 		BatteryMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Battery Mesh"));
 		SetRootComponent(BatteryMesh);
@@ -26,6 +76,11 @@ void ABattery::Recharge_Exec()
 
 	bHasCharge = true;
 
+	if (!bVisualsSignificant)
+	{
+		return;
+	}
+
 	check(BatteryMesh);
 
 	BatteryMesh->SetMaterial(EmissiveMaterialSlotIndex, ChargedMaterial);
@@ -43,6 +98,11 @@ void ABattery::Discharge_Exec()
 
 	bHasCharge = false;
 
+	if (!bVisualsSignificant)
+	{
+		return;
+	}
+
 	check(BatteryMesh);
 
 	BatteryMesh->SetMaterial(EmissiveMaterialSlotIndex, DischargedMaterial);
@@ -51,6 +111,100 @@ void ABattery::Discharge_Exec()
 }
 
 
+void ABattery::SetChargeImmediate(bool bCharged)
+{
+	bHasCharge = bCharged;
+
+	// Applied when the battery becomes significant
+	if (!bVisualsSignificant)
+	{
+		return;
+	}
+
+	check(BatteryMesh);
+
+	BatteryMesh->SetMaterial(EmissiveMaterialSlotIndex, GetActiveMaterial());
+}
+
+void ABattery::SetVisualsSignificant(bool bSignificant)
+{
+	if (FPUVisualSignificance::AreVisualsStripped())
+	{
+		return;
+	}
+
+	const bool bBecameSignificant = bSignificant && !bVisualsSignificant;
+
+	bVisualsSignificant = bSignificant;
+
+	if (bBecameSignificant)
+	{
+		SetChargeImmediate(bHasCharge);
+	}
+}
+
+void ABattery::BakeDischargeParameters(TSubclassOf<ABattery> BatteryClass, int32 MaxLevel)
+{
+	check(IsInGameThread());
+	check(BatteryClass);
+
+#if WITH_EDITOR
+	// Blueprint batteries can be edited between PIE sessions without a curve table changing
+	static const FDelegateHandle WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool)
+	{
+		InvalidateBakedDischargeParameters();
+	});
+#endif
+
+	FBakedDischargeParameters& Baked = BakedDischargeParameters.FindOrAdd(BatteryClass.Get());
+
+	if (Baked.MaxLevel >= MaxLevel)
+	{
+		return;
+	}
+
+	const TMap<FGameplayTag, FScalableFloat>& ClassDischargeParameters = BatteryClass.GetDefaultObject()->DischargeParameters;
+
+	ClassDischargeParameters.GenerateKeyArray(Baked.Tags);
+
+	const int32 NumParameters = Baked.Tags.Num();
+	Baked.Values.SetNumUninitialized(MaxLevel * NumParameters);
+
+	for (int32 i = 0; i < NumParameters; i++)
+	{
+		const FScalableFloat& Parameter = ClassDischargeParameters[Baked.Tags[i]];
+
+		WatchCurveTable(Parameter.Curve.CurveTable);
+
+		for (int32 Level = 1; Level <= MaxLevel; Level++)
+		{
+			Baked.Values[(Level - 1) * NumParameters + i] = Parameter.GetValueAtLevel(Level);
+		}
+	}
+
+	Baked.MaxLevel = MaxLevel;
+}
+
+void ABattery::InvalidateBakedDischargeParameters()
+{
+	check(IsInGameThread());
+
+	BakedDischargeParameters.Reset();
+}
+
+#if WITH_EDITOR
+void ABattery::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	if (PropertyChangedEvent.GetMemberPropertyName() == GET_MEMBER_NAME_CHECKED(ABattery, DischargeParameters))
+	{
+		BakedDischargeParameters.Remove(GetClass());
+	}
+}
+#endif
+
+
 #pragma region === Accessors ===
 
 FGameplayTag ABattery::GetBatteryTypeTag() const
@@ -68,6 +222,11 @@ TSubclassOf<UPUGameplayAbility> ABattery::GetDischargeAbility() const
 	return DischargeAbility;
 }
 
+const FNativeDischargeDescriptor& ABattery::GetNativeDischarge() const
+{
+	return NativeDischarge;
+}
+
 UNiagaraSystem* ABattery::GetDischargeBeamVFX() const
 {
 	return DischargeBeamVFX;
@@ -83,9 +242,44 @@ UMaterialInstance* ABattery::GetActiveMaterial() const
 	return bHasCharge ? ChargedMaterial : DischargedMaterial;
 }
 
+void ABattery::GetVisualAssets(TSet<const UObject*>& OutAssets) const
+{
+	for (const UObject* Asset : { static_cast<const UObject*>(ChargedMaterial), static_cast<const UObject*>(DischargedMaterial),
+		static_cast<const UObject*>(DischargeBeamVFX), static_cast<const UObject*>(DischargeMuzzleVFX) })
+	{
+		if (Asset)
+		{
+			OutAssets.Add(Asset);
+		}
+	}
+}
+
 const FLinearColor& ABattery::GetVisualsColor() const
 {
 	return VisualsColor;
 }
 
+float ABattery::GetDischargeParameter(FGameplayTag ParameterTag, int32 Level) const
+{
+	if (const FBakedDischargeParameters* Baked = BakedDischargeParameters.Find(GetClass()))
+	{
+		// Few enough parameters that a linear search beats hashing
+		const int32 ParameterIndex = Baked->Tags.IndexOfByKey(ParameterTag);
+
+		if (ParameterIndex != INDEX_NONE && Level >= 1 && Level <= Baked->MaxLevel)
+		{
+			return Baked->Values[(Level - 1) * Baked->Tags.Num() + ParameterIndex];
+		}
+	}
+
+	const FScalableFloat* Parameter = DischargeParameters.Find(ParameterTag);
+
+	if (!ensureMsgf(Parameter, TEXT("%s has no discharge parameter %s"), *GetNameSafe(GetClass()), *ParameterTag.ToString()))
+	{
+		return 0.f;
+	}
+
+	return Parameter->GetValueAtLevel(Level);
+}
+
 #pragma endregion
\ No newline at end of file
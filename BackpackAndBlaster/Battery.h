@@ -5,11 +5,40 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "GameplayTagContainer.h"
+#include "ScalableFloat.h"
 #include "ProjectUnrest/GAS/PUGameplayAbility.h"
 #include "Battery.generated.h"
 
 
 class UNiagaraSystem;
+class UGameplayEffect;
+
+
+/*
+ *	A discharge that only applies effects around the hit, which the blaster executes natively instead of creating and
+ *	activating the discharge ability. The blaster spawns the battery's discharge VFX for it.
+ */
+USTRUCT(BlueprintType)
+struct FNativeDischargeDescriptor
+{
+	GENERATED_BODY()
+
+	/* Whether the battery is discharged with this descriptor instead of its discharge ability */
+	UPROPERTY(EditDefaultsOnly, Category = "Native Discharge")
+	bool bEnabled = false;
+
+	/* The effects applied to every target at the discharge level */
+	UPROPERTY(EditDefaultsOnly, Category = "Native Discharge")
+	TArray<TSubclassOf<UGameplayEffect>> Effects;
+
+	/* Radius around the hit location in which pawns other than the instigator are targeted. Zero targets only the hit actor. */
+	UPROPERTY(EditDefaultsOnly, Category = "Native Discharge")
+	float Radius = 0.f;
+
+	/* Tags added to the effect specs */
+	UPROPERTY(EditDefaultsOnly, Category = "Native Discharge")
+	FGameplayTagContainer DynamicAssetTags;
+};
 
 
 /**
@@ -55,6 +84,26 @@ public:
 	void Discharge_BP();
 
 
+	/* Sets the charge and emissive material without animating. Used when restoring a backpack snapshot. */
+	void SetChargeImmediate(bool bCharged);
+
+	/*
+	 *	While not significant, recharging and discharging only change the charge, skipping the material swap and animations.
+	 *	Becoming significant again applies the material for the current charge.
+	 */
+	void SetVisualsSignificant(bool bSignificant);
+
+	/*
+	 *	Flattens the battery class's DischargeParameters into a dense table for levels 1 to MaxLevel, so discharges don't evaluate
+	 *	curve tables. The tables are kept per class outside of the class default object, and are dropped when a curve table they
+	 *	read from changes, or in the editor when a world is cleaned up, so values are never stale across PIE sessions.
+	 */
+	static void BakeDischargeParameters(TSubclassOf<ABattery> BatteryClass, int32 MaxLevel);
+
+	/* Drops every baked table, so the next bake reads the curve tables again */
+	static void InvalidateBakedDischargeParameters();
+
+
 
 	#pragma region === Accessors ===
 
@@ -67,6 +116,8 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Battery")
 	TSubclassOf<UPUGameplayAbility> GetDischargeAbility() const;
 
+	const FNativeDischargeDescriptor& GetNativeDischarge() const;
+
 	UFUNCTION(BlueprintCallable, Category = "Battery")
 	UNiagaraSystem* GetDischargeBeamVFX() const;
 
@@ -76,28 +127,48 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Battery")
 	const FLinearColor& GetVisualsColor() const;
 
+	/* Returns the discharge parameter at the given level from the baked table, evaluating its curve only if the level wasn't baked */
+	UFUNCTION(BlueprintCallable, Category = "Battery")
+	float GetDischargeParameter(FGameplayTag ParameterTag, int32 Level) const;
+
 	/* Returns the active material depending on if has charge */
 	UMaterialInstance* GetActiveMaterial() const;
 
+	/* Adds the materials and VFX this battery references to the set */
+	void GetVisualAssets(TSet<const UObject*>& OutAssets) const;
+
 
 #pragma endregion
 
 
 protected:
-	/* The static mesh of the battery */
+#if WITH_EDITOR
+	/* Drops the class's baked table when its discharge parameters are edited */
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/* The static mesh of the battery. Not created on dedicated servers. */
 	UPROPERTY(EditDefaultsOnly, Category = "Battery")
 	UStaticMeshComponent* BatteryMesh = nullptr;
 
-
-private:
 	/* An identifier for this battery type */
-	UPROPERTY(EditDefaultsOnly, Category = "Battery", meta = (AllowPrivateAccess = "true"))
+	UPROPERTY(EditDefaultsOnly, Category = "Battery")
 	FGameplayTag BatteryTypeTag = FGameplayTag::EmptyTag;
 
 	/* The ability unique to this battery type that is activated when it is discharged from the blaster */
-	UPROPERTY(EditDefaultsOnly, Category = "Battery", meta = (AllowPrivateAccess = "true"))
+	UPROPERTY(EditDefaultsOnly, Category = "Battery")
 	TSubclassOf<UPUGameplayAbility> DischargeAbility = nullptr;
 
+	/* For battery types whose discharge only applies effects. When enabled, DischargeAbility isn't used. */
+	UPROPERTY(EditDefaultsOnly, Category = "Battery")
+	FNativeDischargeDescriptor NativeDischarge;
+
+	/* Values used by the discharge ability (e.g., damage, radius) that scale with the discharge level */
+	UPROPERTY(EditDefaultsOnly, Category = "Battery")
+	TMap<FGameplayTag, FScalableFloat> DischargeParameters;
+
+
+private:
 	/* The material for when the battery has charge */
 	UPROPERTY(EditDefaultsOnly, Category = "Battery", meta = (AllowPrivateAccess = "true"))
 	UMaterialInstance* ChargedMaterial = nullptr;
@@ -121,6 +192,9 @@ private:
 	/* Whether the battery has charge and can be discharged */
 	bool bHasCharge = true;
 
+	/* Whether the owner is significant enough to update visuals, see SetVisualsSignificant */
+	bool bVisualsSignificant = true;
+
 	/* The material slot index for the emissive material that changes when the charge state changes */
 	int32 EmissiveMaterialSlotIndex = 1;
 };
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ProjectUnrest/Actors/ShootLoopTestFixture.h"
+#include "ProjectUnrest/Actors/ShootLoopTestTypes.h"
+#include "ProjectUnrest/Actors/Battery.h"
+#include "Engine/CurveTable.h"
+
+
+BEGIN_DEFINE_SPEC(FPUBatterySpec, "ProjectUnrest.Battery", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	UCurveTable* CurveTable = nullptr;
+
+	FScalableFloat DamageParameter;
+
+	const int32 MaxLevel = 6;
+
+	/* Checks that the baked parameter matches its curve at every baked level */
+	void TestBakedMatchesCurve(const TCHAR* What);
+
+END_DEFINE_SPEC(FPUBatterySpec)
+
+
+void FPUBatterySpec::TestBakedMatchesCurve(const TCHAR* What)
+{
+	const ABattery* BatteryCDO = GetDefault<APUTestBatteryParameterized>();
+
+	for (int32 Level = 1; Level <= MaxLevel; Level++)
+	{
+		TestEqual(FString::Printf(TEXT("%s at level %d"), What, Level), BatteryCDO->GetDischargeParameter(TAG_PU_Test_Parameter_Damage, Level), DamageParameter.GetValueAtLevel(Level));
+	}
+}
+
+
+void FPUBatterySpec::Define()
+{
+	BeforeEach([this]()
+	{
+		// The table is the battery class's own, so it is refilled here in case a test changed it
+		CurveTable = GetDefault<APUTestBatteryParameterized>()->GetDischargeCurveTable();
+
+		TestEqual(TEXT("Curve table problems"), CurveTable->CreateTableFromCSVString(TEXT("Name,1,2,3,4,5,6\nDamage,10,12,15,19,24,30\n")).Num(), 0);
+
+		UCurveTable::InvalidateAllCachedCurves();
+
+		DamageParameter = FScalableFloat(1.f);
+		DamageParameter.Curve.CurveTable = CurveTable;
+		DamageParameter.Curve.RowName = TEXT("Damage");
+
+		ABattery::InvalidateBakedDischargeParameters();
+	});
+
+	AfterEach([this]()
+	{
+		ABattery::InvalidateBakedDischargeParameters();
+
+		CurveTable = nullptr;
+	});
+
+
+	Describe("Baked discharge parameters", [this]()
+	{
+		It("should match the curve at every baked level", [this]()
+		{
+			ABattery::BakeDischargeParameters(APUTestBatteryParameterized::StaticClass(), MaxLevel);
+
+			TestEqual(TEXT("Damage at level 3"), GetDefault<APUTestBatteryParameterized>()->GetDischargeParameter(TAG_PU_Test_Parameter_Damage, 3), 15.f);
+			TestBakedMatchesCurve(TEXT("Baked damage"));
+		});
+
+		It("should fall back to the curve above the baked levels", [this]()
+		{
+			ABattery::BakeDischargeParameters(APUTestBatteryParameterized::StaticClass(), 2);
+
+			TestBakedMatchesCurve(TEXT("Partly baked damage"));
+		});
+
+		It("should rebake after the curve table changes", [this]()
+		{
+			ABattery::BakeDischargeParameters(APUTestBatteryParameterized::StaticClass(), MaxLevel);
+
+			CurveTable->CreateTableFromCSVString(TEXT("Name,1,2,3,4,5,6\nDamage,20,24,30,38,48,60\n"));
+
+			// As a reimport does, so that scalable floats drop their cached rows and bakes are dropped
+			UCurveTable::InvalidateAllCachedCurves();
+			CurveTable->OnCurveTableChanged().Broadcast();
+
+			TestEqual(TEXT("Damage at level 3 after the change"), GetDefault<APUTestBatteryParameterized>()->GetDischargeParameter(TAG_PU_Test_Parameter_Damage, 3), 30.f);
+			TestBakedMatchesCurve(TEXT("Damage after the change"));
+
+			ABattery::BakeDischargeParameters(APUTestBatteryParameterized::StaticClass(), MaxLevel);
+
+			TestBakedMatchesCurve(TEXT("Rebaked damage"));
+		});
+	});
+}
+
+#endif
@@ -4,21 +4,63 @@
 #include "ProjectUnrest/Actors/PUBlaster.h"
 #include "ProjectUnrest/Actors/Battery.h"
 #include "ProjectUnrest/Actors/Backpack.h"
+#include "ProjectUnrest/Actors/BackpackMemory.h"
+#include "ProjectUnrest/Actors/VisualSignificance.h"
 #include "ProjectUnrest/GAS/PUAbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "NiagaraComponent.h"
+#include "NiagaraFunctionLibrary.h"
+#include "Engine/OverlapResult.h"
+#include "ProjectUnrest/Telemetry/PUTelemetry.h"
+#include "ProjectUnrest/Telemetry/PUProfiling.h"
 
 
+DEFINE_LOG_CATEGORY_STATIC(LogPUBlaster, Log, All);
+
+
+namespace
+{
+	/* Returns whether the ability declares a gameplay event trigger with the tag. The triggers are protected, so they are read through reflection. */
+	bool IsTriggeredByEvent(const UGameplayAbility* Ability, FGameplayTag EventTag)
+	{
+		static const FProperty* AbilityTriggersProperty = FindFProperty<FProperty>(UGameplayAbility::StaticClass(), TEXT("AbilityTriggers"));
+		check(AbilityTriggersProperty);
+
+		const TArray<FAbilityTriggerData>* AbilityTriggers = AbilityTriggersProperty->ContainerPtrToValuePtr<TArray<FAbilityTriggerData>>(Ability);
+
+		return AbilityTriggers->ContainsByPredicate([EventTag](const FAbilityTriggerData& Trigger)
+		{
+			return Trigger.TriggerSource == EGameplayAbilityTriggerSource::GameplayEvent && Trigger.TriggerTag == EventTag;
+		});
+	}
+}
+
 
 APUBlaster::APUBlaster()
 {
+	LLM_SCOPE_BYTAG(PU_Blaster);
+
 	PrimaryActorTick.bCanEverTick = false;
 
-	BlasterMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("BlasterMesh"));
-	SetRootComponent(BlasterMesh);
+	bVisualsSignificant = !FPUVisualSignificance::AreVisualsStripped();
+
+	// Dedicated servers only need a transform to attach to the owner
+	if (!bVisualsSignificant)
+	{
+		SetRootComponent(CreateDefaultSubobject<USceneComponent>(TEXT("Root")));
+	}
+	else
+	{
+		BlasterMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("BlasterMesh"));
+		SetRootComponent(BlasterMesh);
+	}
 }
 
 
 void APUBlaster::Init(UPUAbilitySystemComponent* _OwnerASC, ABackpack* _Backpack)
 {
+	LLM_SCOPE_BYTAG(PU_Blaster);
+
 	check(_OwnerASC);
 	check(_Backpack);
 
@@ -30,10 +72,23 @@ void APUBlaster::Init(UPUAbilitySystemComponent* _OwnerASC, ABackpack* _Backpack
 	Backpack->CurrentBatteryChangedEvent.AddDynamic(this, &APUBlaster::UpdateEmissiveMaterial);
 
 	UpdateEmissiveMaterial();
+
+	FPUVisualSignificance::Register(this, [this](bool bSignificant) { SetVisualsSignificant(bSignificant); });
+}
+
+void APUBlaster::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FPUVisualSignificance::Unregister(this);
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void APUBlaster::Discharge(FHitResult HitScanResult)
 {
+	CSV_SCOPED_TIMING_STAT(PUShooting, Discharge);
+	CSV_CUSTOM_STAT(PUShooting, DischargeCount, 1, ECsvCustomStatOp::Accumulate);
+	LLM_SCOPE_BYTAG(PU_Blaster);
+
 	FGameplayEventData EventData;
 
 	FGameplayEffectContextHandle GameplayContextHandle = OwnerASC->MakeEffectContext();
@@ -41,30 +96,203 @@ void APUBlaster::Discharge(FHitResult HitScanResult)
 	GameplayContextHandle.AddSourceObject(this);
 	GameplayContextHandle.AddOrigin(GetActorLocation());
 
+	const ABattery* CurrentBattery = Backpack->GetCurrentBattery();
+	check(CurrentBattery);
+
 	EventData.ContextHandle = GameplayContextHandle;
 	EventData.Instigator = Owner;
 
+	// Lets the discharge ability read the battery's baked discharge parameters
+	EventData.OptionalObject = CurrentBattery;
 
-	const ABattery* CurrentBattery = Backpack->GetCurrentBattery();
-	check(CurrentBattery);
 
-	FGameplayAbilitySpec AbilitySpec =
-		FGameplayAbilitySpec(CurrentBattery->GetDischargeAbility(), Backpack->GetCurrentBatteryCount());
+	const int32 DischargeLevel = Backpack->GetCurrentBatteryCount();
+
+	const uint64 ActivateStartCycles = FPlatformTime::Cycles64();
+
+	if (CurrentBattery->GetNativeDischarge().bEnabled)
+	{
+		CSV_SCOPED_TIMING_STAT(PUShooting, DischargeNative);
+
+		ExecuteNativeDischarge(CurrentBattery, DischargeLevel, GameplayContextHandle, HitScanResult);
+	}
+	else
+	{
+		CSV_SCOPED_TIMING_STAT(PUShooting, DischargeAbility);
+
+		// Stays under PU_Blaster. The ability's VFX are tracked under PU_DischargeVFX by SpawnDischargeVFX.
+		const TSubclassOf<UPUGameplayAbility> DischargeAbility = CurrentBattery->GetDischargeAbility();
+
+		// GiveAbilityAndActivateOnce rejects non-instanced abilities, which have to be granted and activated instead
+		if (ensureMsgf(DischargeAbility && DischargeAbility.GetDefaultObject()->GetInstancingPolicy() != EGameplayAbilityInstancingPolicy::NonInstanced,
+			TEXT("Discharge ability %s is missing or non-instanced"), *GetNameSafe(DischargeAbility)))
+		{
+			FGameplayAbilitySpec AbilitySpec = FGameplayAbilitySpec(DischargeAbility, DischargeLevel);
 
+			OwnerASC->GiveAbilityAndActivateOnce(AbilitySpec, &EventData);
+			FBackpackMemoryTracker::CountTransientAbilitySpec();
+		}
+	}
+
+	TrackFirstDischargeLatency(CurrentBattery->GetBatteryTypeTag(), FPlatformTime::Cycles64() - ActivateStartCycles);
 
-	OwnerASC->GiveAbilityAndActivateOnce(AbilitySpec, &EventData);
+	EventData.EventTag = DischargeEventTag;
+	DispatchUpgradeEvent(CurrentBattery->GetBatteryTypeTag(), DischargeEventTag, EventData);
 
+	// Still sent for gameplay event listeners, e.g. WaitGameplayEvent tasks
 	OwnerASC->HandleGameplayEvent(DischargeEventTag, &EventData);
 
+	FPUTelemetry::Record(EPUTelemetryEvent::Shot, CurrentBattery->GetBatteryTypeTag().GetTagName(), DischargeLevel, Backpack->GetUniqueID());
+
 
 	Backpack->DischargeCurrentBattery();
 }
 
+void APUBlaster::ApplyMultiHitDischarge(const FMultiHitDischargeParams& Params, FVector Origin, const TArray<FHitResult>& Hits, int32 Level)
+{
+	CSV_SCOPED_TIMING_STAT(PUShooting, MultiHitDischarge);
+
+	check(OwnerASC);
+
+	if (Hits.Num() == 0 || !ensure(Params.DamageEffect))
+	{
+		return;
+	}
+
+	// A piercing trace can hit several components of one actor, so each ASC is only damaged once, at its closest hit
+	MultiHitTargetASCs.Reset();
+	MultiHitTargetLocations.Reset();
+	MultiHitTargetIndices.Reset();
+
+	for (const FHitResult& Hit : Hits)
+	{
+		UAbilitySystemComponent* TargetASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Hit.GetActor());
+
+		if (TargetASC == nullptr)
+		{
+			continue;
+		}
+
+		if (const int32* TargetIndex = MultiHitTargetIndices.Find(TargetASC))
+		{
+			FVector& TargetLocation = MultiHitTargetLocations[*TargetIndex];
+
+			if (FVector::DistSquared(Hit.ImpactPoint, Origin) < FVector::DistSquared(TargetLocation, Origin))
+			{
+				TargetLocation = Hit.ImpactPoint;
+			}
+
+			continue;
+		}
+
+		MultiHitTargetIndices.Add(TargetASC, MultiHitTargetASCs.Add(TargetASC));
+		MultiHitTargetLocations.Add(Hit.ImpactPoint);
+	}
+
+	if (MultiHitTargetASCs.Num() == 0)
+	{
+		return;
+	}
+
+
+	MultiHitBatch.Reset(MultiHitTargetASCs.Num());
+
+	for (int32 i = 0; i < MultiHitTargetASCs.Num(); i++)
+	{
+		MultiHitBatch.SetTarget(i, MultiHitTargetLocations[i] - Origin);
+	}
+
+	MultiHitBatch.Compute(Params);
+
+
+	FGameplayEffectContextHandle GameplayContextHandle = OwnerASC->MakeEffectContext();
+	GameplayContextHandle.AddSourceObject(this);
+	GameplayContextHandle.AddOrigin(Origin);
+
+	FGameplayEffectSpecHandle DamageSpec = OwnerASC->MakeOutgoingSpec(Params.DamageEffect, Level, GameplayContextHandle);
+
+	for (int32 TargetIndex : MultiHitBatch.ChainOrder)
+	{
+		// The spec is copied when applied, so one spec serves every target
+		DamageSpec.Data->SetSetByCallerMagnitude(Params.DamageSetByCallerTag, MultiHitBatch.Damages[TargetIndex]);
+		OwnerASC->ApplyGameplayEffectSpecToTarget(*DamageSpec.Data, MultiHitTargetASCs[TargetIndex]);
+	}
+}
+
+FGameplayAbilitySpecHandle APUBlaster::GiveDischargeUpgrade(TSubclassOf<UPUGameplayAbility> UpgradeAbility, FGameplayTag BatteryTypeTag, FGameplayTag EventTag)
+{
+	check(OwnerASC);
+	check(UpgradeAbility);
+
+	ensureMsgf(!IsTriggeredByEvent(UpgradeAbility.GetDefaultObject(), EventTag), TEXT("Upgrade %s is triggered by %s, so it would activate twice. Remove the trigger from the ability."),
+		*GetNameSafe(UpgradeAbility), *EventTag.ToString());
+
+	FGameplayAbilitySpecHandle UpgradeHandle = OwnerASC->GiveAbility(FGameplayAbilitySpec(UpgradeAbility, 1, INDEX_NONE, this));
+
+	if (ensureMsgf(UpgradeHandle.IsValid(), TEXT("Failed to give upgrade: %s"), *GetNameSafe(UpgradeAbility)))
+	{
+		UpgradeDispatchTable.FindOrAdd(MakeTuple(BatteryTypeTag, EventTag)).Add(UpgradeHandle);
+	}
+
+	return UpgradeHandle;
+}
+
+void APUBlaster::RemoveDischargeUpgrade(FGameplayAbilitySpecHandle UpgradeHandle)
+{
+	for (auto It = UpgradeDispatchTable.CreateIterator(); It; ++It)
+	{
+		if (It->Value.Remove(UpgradeHandle) > 0 && It->Value.Num() == 0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	OwnerASC->ClearAbility(UpgradeHandle);
+}
+
+void APUBlaster::SpawnDischargeVFX(const ABattery* Battery, const FHitResult& HitScanResult)
+{
+	check(Battery);
+
+	if (!bVisualsSignificant)
+	{
+		return;
+	}
+
+	LLM_SCOPE_BYTAG(PU_DischargeVFX);
+
+	const FVector MuzzleLocation = BlasterMesh->GetSocketLocation(MuzzleSocketName);
+	const FVector BeamEnd = HitScanResult.bBlockingHit ? HitScanResult.ImpactPoint : HitScanResult.TraceEnd;
+
+	// Both are returned to the Niagara pool when they finish, where the backpack warmed them up
+	if (UNiagaraSystem* BeamVFX = Battery->GetDischargeBeamVFX())
+	{
+		UNiagaraComponent* BeamComponent = UNiagaraFunctionLibrary::SpawnSystemAtLocation(
+			this, BeamVFX, MuzzleLocation, (BeamEnd - MuzzleLocation).Rotation(), FVector::OneVector, true, true, ENCPoolMethod::AutoRelease);
+
+		if (BeamComponent)
+		{
+			BeamComponent->SetVariableVec3(BeamEndParameterName, BeamEnd);
+		}
+	}
+
+	if (UNiagaraSystem* MuzzleVFX = Battery->GetDischargeMuzzleVFX())
+	{
+		UNiagaraFunctionLibrary::SpawnSystemAttached(
+			MuzzleVFX, BlasterMesh, MuzzleSocketName, FVector::ZeroVector, FRotator::ZeroRotator, EAttachLocation::SnapToTarget, true, true, ENCPoolMethod::AutoRelease);
+	}
+}
+
 const ABackpack* APUBlaster::GetBackpack() const
 {
 	return Backpack;
 }
 
+bool APUBlaster::AreVisualsSignificant() const
+{
+	return bVisualsSignificant;
+}
+
 
 
 void APUBlaster::GiveDefaultAbilities()
@@ -77,8 +305,108 @@ void APUBlaster::GiveDefaultAbilities()
 	}
 }
 
+void APUBlaster::DispatchUpgradeEvent(FGameplayTag BatteryTypeTag, FGameplayTag EventTag, const FGameplayEventData& EventData)
+{
+	// Copied, since an upgrade could give or remove upgrades when activated
+	TArray<FGameplayAbilitySpecHandle, TInlineAllocator<16>> UpgradeHandles;
+
+	if (const TArray<FGameplayAbilitySpecHandle>* TypeUpgrades = UpgradeDispatchTable.Find(MakeTuple(BatteryTypeTag, EventTag)))
+	{
+		UpgradeHandles.Append(*TypeUpgrades);
+	}
+
+	// An untyped battery's lookup above already found the upgrades for every type
+	if (BatteryTypeTag.IsValid())
+	{
+		if (const TArray<FGameplayAbilitySpecHandle>* AnyTypeUpgrades = UpgradeDispatchTable.Find(MakeTuple(FGameplayTag::EmptyTag, EventTag)))
+		{
+			UpgradeHandles.Append(*AnyTypeUpgrades);
+		}
+	}
+
+	for (const FGameplayAbilitySpecHandle& UpgradeHandle : UpgradeHandles)
+	{
+		OwnerASC->TriggerAbilityFromGameplayEvent(UpgradeHandle, OwnerASC->AbilityActorInfo.Get(), EventTag, &EventData, *OwnerASC);
+	}
+}
+
+void APUBlaster::ExecuteNativeDischarge(const ABattery* Battery, int32 Level, const FGameplayEffectContextHandle& GameplayContextHandle, const FHitResult& HitScanResult)
+{
+	const FNativeDischargeDescriptor& NativeDischarge = Battery->GetNativeDischarge();
+
+	// Has no ability to spawn them, so the discharge spawns its own VFX
+	SpawnDischargeVFX(Battery, HitScanResult);
+
+
+	TArray<UAbilitySystemComponent*, TInlineAllocator<8>> TargetASCs;
+
+	if (NativeDischarge.Radius > 0.f)
+	{
+		TArray<FOverlapResult> Overlaps;
+		GetWorld()->OverlapMultiByObjectType(Overlaps, HitScanResult.Location, FQuat::Identity, FCollisionObjectQueryParams(ECC_Pawn), FCollisionShape::MakeSphere(NativeDischarge.Radius));
+
+		for (const FOverlapResult& Overlap : Overlaps)
+		{
+			UAbilitySystemComponent* TargetASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Overlap.GetActor());
+
+			// The radius can reach back to the instigator, who shouldn't be hit by their own discharge
+			if (TargetASC && TargetASC != OwnerASC)
+			{
+				TargetASCs.AddUnique(TargetASC);
+			}
+		}
+	}
+	else if (UAbilitySystemComponent* TargetASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(HitScanResult.GetActor()))
+	{
+		TargetASCs.Add(TargetASC);
+	}
+
+
+	if (TargetASCs.Num() == 0)
+	{
+		return;
+	}
+
+	for (TSubclassOf<UGameplayEffect> Effect : NativeDischarge.Effects)
+	{
+		// Built per shot, so the spec captures the source's current attributes and tags. It is copied when applied, so one serves every target.
+		const FGameplayEffectSpecHandle EffectSpec = OwnerASC->MakeOutgoingSpec(Effect, Level, GameplayContextHandle);
+		EffectSpec.Data->AppendDynamicAssetTags(NativeDischarge.DynamicAssetTags);
+
+		for (UAbilitySystemComponent* TargetASC : TargetASCs)
+		{
+			OwnerASC->ApplyGameplayEffectSpecToTarget(*EffectSpec.Data, TargetASC);
+		}
+	}
+}
+
+void APUBlaster::TrackFirstDischargeLatency(FGameplayTag BatteryTypeTag, uint64 ActivateCycles)
+{
+	bool bAlreadyDischarged = false;
+	DischargedBatteryTypes.Add(BatteryTypeTag, &bAlreadyDischarged);
+
+	if (bAlreadyDischarged)
+	{
+		return;
+	}
+
+	const double LatencyMs = FPlatformTime::ToMilliseconds64(ActivateCycles);
+
+	UE_LOG(LogPUBlaster, Verbose, TEXT("%s first discharge of %s took %.3f ms"), *GetName(), *BatteryTypeTag.ToString(), LatencyMs);
+
+#if CSV_PROFILER
+	const FName StatName = FName(*(TEXT("FirstDischargeMs_") + BatteryTypeTag.ToString()));
+	FCsvProfiler::RecordCustomStat(StatName, CSV_CATEGORY_INDEX(PUShooting), static_cast<float>(LatencyMs), ECsvCustomStatOp::Max);
+#endif
+}
+
 void APUBlaster::UpdateEmissiveMaterial()
 {
+	if (!bVisualsSignificant)
+	{
+		return;
+	}
+
 	const ABattery* CurrentBattery = Backpack->GetCurrentBattery();
 
 	check(CurrentBattery);
@@ -88,3 +416,15 @@ void APUBlaster::UpdateEmissiveMaterial()
 		BlasterMesh->SetMaterial(EmissiveMaterialSlot, CurrentBattery->GetActiveMaterial());
 	}
 }
+
+void APUBlaster::SetVisualsSignificant(bool bSignificant)
+{
+	if (bSignificant == bVisualsSignificant || FPUVisualSignificance::AreVisualsStripped())
+	{
+		return;
+	}
+
+	bVisualsSignificant = bSignificant;
+
+	UpdateEmissiveMaterial();
+}
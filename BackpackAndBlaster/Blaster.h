@@ -5,11 +5,14 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "ProjectUnrest/GAS/PUGameplayAbility.h"
+#include "ProjectUnrest/Actors/MultiHitDischarge.h"
 #include "PUBlaster.generated.h"
 
 
+class UAbilitySystemComponent;
 class UPUAbilitySystemComponent;
 class ABackpack;
+class ABattery;
 
 
 /*
@@ -28,12 +31,44 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Blaster")
 	void Init(UPUAbilitySystemComponent* _OwnerASC, ABackpack* _Backpack);
 
-	/* Gives and activates current battery discharge ability and sends discharge event to owner ASC to trigger discharge upgrades */
+	/*
+	 *	Gives and activates current battery discharge ability, or executes its native discharge if it has one, and sends discharge
+	 *	event to owner ASC to trigger discharge upgrades
+	 */
 	UFUNCTION(BlueprintCallable, Category = "Blaster")
 	void Discharge(FHitResult HitScanResult);
 
+	/*
+	 *	Gives the owner an upgrade ability that is activated when the given event happens while discharging a battery of the given type,
+	 *	or any type if the tag is empty. The ability must not also declare the event as a trigger, or it will activate twice.
+	 *	To migrate an upgrade that is triggered by the discharge event, remove the trigger from the ability and give it with this
+	 *	instead of GiveAbility. Upgrades that keep the trigger still work, but each discharge finds them through HandleGameplayEvent.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Blaster")
+	FGameplayAbilitySpecHandle GiveDischargeUpgrade(TSubclassOf<UPUGameplayAbility> UpgradeAbility, FGameplayTag BatteryTypeTag, FGameplayTag EventTag);
+
+	/*
+	 *	For piercing and chaining discharge abilities. Computes the falloff and chain damage of every hit target as a batch, then
+	 *	applies one damage effect spec to each target's ASC in a single pass, from closest to furthest. Hits on actors without an ASC
+	 *	are ignored, and several hits on the same ASC count as one target at the closest of them.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Blaster")
+	void ApplyMultiHitDischarge(const FMultiHitDischargeParams& Params, FVector Origin, const TArray<FHitResult>& Hits, int32 Level = 1);
+
+	/*
+	 *	Spawns the battery's beam VFX from the muzzle to the hit, and its muzzle VFX on the muzzle, from the Niagara pool. Does nothing
+	 *	while visuals aren't significant. Discharge abilities should spawn their VFX with this, as native discharges do, so that
+	 *	the VFX memory is tracked under PU_DischargeVFX apart from the ability.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Blaster")
+	void SpawnDischargeVFX(const ABattery* Battery, const FHitResult& HitScanResult);
+
+	/* Removes an upgrade given with GiveDischargeUpgrade from the owner */
+	UFUNCTION(BlueprintCallable, Category = "Blaster")
+	void RemoveDischargeUpgrade(FGameplayAbilitySpecHandle UpgradeHandle);
+
 protected:
-	/* The blaster's static mesh */
+	/* The blaster's static mesh. Not created on dedicated servers, where it is null and a plain scene component is the root. */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Blaster")
 	UStaticMeshComponent* BlasterMesh = nullptr;
 
@@ -41,17 +76,38 @@ protected:
 	UPROPERTY(BlueprintReadOnly, Category = "Blaster")
 	UPUAbilitySystemComponent* OwnerASC = nullptr;
 
+	/* The tag that will go on the event made when the current battery is discharged */
+	UPROPERTY(EditDefaultsOnly, Category = "Blaster")
+	FGameplayTag DischargeEventTag;
+
 	UFUNCTION(BlueprintCallable, Category = "Blaster")
 	const ABackpack* GetBackpack() const;
 
+	/* Returns whether the owner is significant enough for visuals, e.g. discharge VFX, to be spawned */
+	UFUNCTION(BlueprintCallable, Category = "Blaster")
+	bool AreVisualsSignificant() const;
+
+	/* Unregisters from visual significance */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/* Activates only the upgrades indexed under the given battery type and event, plus those for every battery type */
+	void DispatchUpgradeEvent(FGameplayTag BatteryTypeTag, FGameplayTag EventTag, const FGameplayEventData& EventData);
+
+	/* Skips or restores the blaster visuals, applying the current emissive material when restored */
+	void SetVisualsSignificant(bool bSignificant);
+
 private:
 	/* Abilities that should be granted to the owner for having a blaster */
 	UPROPERTY(EditDefaultsOnly, Category = "Blaster", meta = (AllowPrivateAccess = "true"))
 	TArray<TSubclassOf<UPUGameplayAbility>> DefaultAbilities;
 
-	/* The tag that will go on the event made when the current battery is discharged */
+	/* The socket on BlasterMesh that discharge VFX are spawned at */
 	UPROPERTY(EditDefaultsOnly, Category = "Blaster", meta = (AllowPrivateAccess = "true"))
-	FGameplayTag DischargeEventTag;
+	FName MuzzleSocketName = TEXT("Muzzle");
+
+	/* The vector parameter of the discharge beam VFX that is set to the end of the beam */
+	UPROPERTY(EditDefaultsOnly, Category = "Blaster", meta = (AllowPrivateAccess = "true"))
+	FName BeamEndParameterName = TEXT("BeamEnd");
 
 	/* The backpack on the owner of this blaster and which the blaster is dependent on */
 	ABackpack* Backpack = nullptr;
@@ -59,10 +115,33 @@ private:
 	/* The material slot index for the emissive material that changes when current battery changes */
 	int32 EmissiveMaterialSlot = 1;
 
+	/* Whether the owner is significant enough to update visuals. Emissive updates are skipped while false. */
+	bool bVisualsSignificant = true;
+
+	/* The battery types that have been discharged, used to track first discharge latency */
+	TSet<FGameplayTag> DischargedBatteryTypes;
+
+	/* Reused by ApplyMultiHitDischarge to avoid reallocating per discharge */
+	FMultiHitDischargeBatch MultiHitBatch;
+
+	/* The distinct target ASCs of the discharge in ApplyMultiHitDischarge, their closest hit locations, and their index by ASC */
+	TArray<UAbilitySystemComponent*> MultiHitTargetASCs;
+	TArray<FVector> MultiHitTargetLocations;
+	TMap<UAbilitySystemComponent*, int32> MultiHitTargetIndices;
+
+	/* Upgrades given with GiveDischargeUpgrade, indexed by (battery type, event tag). An empty battery type matches every battery. */
+	TMap<TPair<FGameplayTag, FGameplayTag>, TArray<FGameplayAbilitySpecHandle>> UpgradeDispatchTable;
+
 
 	/** Gives the OwnerASC abilities that come with a blaster */
 	void GiveDefaultAbilities();
 
+	/* Spawns the battery's discharge VFX and applies its native discharge effects to the hit actor, or every other pawn within its radius of the hit */
+	void ExecuteNativeDischarge(const ABattery* Battery, int32 Level, const FGameplayEffectContextHandle& GameplayContextHandle, const FHitResult& HitScanResult);
+
+	/* Records how long the discharge ability or native discharge took if it was the first discharge of the battery type */
+	void TrackFirstDischargeLatency(FGameplayTag BatteryTypeTag, uint64 ActivateCycles);
+
 	/* Sets the blaster's emissive material to that of the current battery */
 	UFUNCTION()
 	void UpdateEmissiveMaterial();
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ProjectUnrest/Actors/ShootLoopTestFixture.h"
+#include "ProjectUnrest/Actors/ShootLoopTestTypes.h"
+#include "ProjectUnrest/Actors/Backpack.h"
+#include "ProjectUnrest/Actors/Battery.h"
+#include "ProjectUnrest/Actors/PUBlaster.h"
+#include "GameFramework/Character.h"
+
+
+BEGIN_DEFINE_SPEC(FPUBlasterSpec, "ProjectUnrest.Blaster", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	FPUShootLoopTestWorld TestWorld;
+
+	FPUTestShooter Shooter;
+
+	FMultiHitDischargeParams Params;
+
+	static FHitResult MakeHit(UAbilitySystemComponent* TargetASC, const FVector& Location);
+
+	static float GetDamageTaken(const UAbilitySystemComponent* TargetASC);
+
+	/* Returns how many times an upgrade given to the shooter's blaster was activated */
+	int32 GetUpgradeActivations(FGameplayAbilitySpecHandle UpgradeHandle) const;
+
+END_DEFINE_SPEC(FPUBlasterSpec)
+
+
+FHitResult FPUBlasterSpec::MakeHit(UAbilitySystemComponent* TargetASC, const FVector& Location)
+{
+	return FHitResult(TargetASC->GetOwner(), nullptr, Location, FVector::UpVector);
+}
+
+float FPUBlasterSpec::GetDamageTaken(const UAbilitySystemComponent* TargetASC)
+{
+	return TargetASC->GetNumericAttribute(UPUTestAttributeSet::GetDamageTakenAttribute());
+}
+
+int32 FPUBlasterSpec::GetUpgradeActivations(FGameplayAbilitySpecHandle UpgradeHandle) const
+{
+	const FGameplayAbilitySpec* UpgradeSpec = Shooter.ASC->FindAbilitySpecFromHandle(UpgradeHandle);
+	const UPUTestUpgradeAbility* Upgrade = UpgradeSpec ? Cast<UPUTestUpgradeAbility>(UpgradeSpec->GetPrimaryInstance()) : nullptr;
+
+	return Upgrade ? Upgrade->ActivationCount : 0;
+}
+
+
+void FPUBlasterSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		TestWorld.Create();
+		Shooter = TestWorld.SpawnShooter(false);
+
+		// No falloff, so only the chain scales the damage
+		Params.DamageEffect = UPUTestDamageEffect::StaticClass();
+		Params.DamageSetByCallerTag = TAG_PU_Test_SetByCaller_Damage;
+		Params.BaseDamage = 10.f;
+		Params.FalloffStartDistance = 10000.f;
+		Params.FalloffEndDistance = 20000.f;
+		Params.ChainDamageScale = 0.5f;
+	});
+
+	AfterEach([this]()
+	{
+		TestWorld.Destroy();
+	});
+
+
+	Describe("ApplyMultiHitDischarge", [this]()
+	{
+		It("should damage an ASC hit several times once, at its closest hit", [this]()
+		{
+			UAbilitySystemComponent* First = TestWorld.SpawnTarget(FVector(100.f, 0.f, 0.f));
+			UAbilitySystemComponent* Second = TestWorld.SpawnTarget(FVector(200.f, 0.f, 0.f));
+
+			// A piercing trace through the first target's components, with its far side hit after the second target
+			const TArray<FHitResult> Hits = {
+				MakeHit(First, FVector(90.f, 0.f, 0.f)),
+				MakeHit(Second, FVector(200.f, 0.f, 0.f)),
+				MakeHit(First, FVector(300.f, 0.f, 0.f))
+			};
+
+			Shooter.Blaster->ApplyMultiHitDischarge(Params, FVector::ZeroVector, Hits);
+
+			TestEqual(TEXT("First target damage"), GetDamageTaken(First), 10.f);
+			TestEqual(TEXT("Second target damage, one link down the chain"), GetDamageTaken(Second), 5.f);
+		});
+
+		It("should ignore hits on actors without an ASC", [this]()
+		{
+			UAbilitySystemComponent* Target = TestWorld.SpawnTarget(FVector(200.f, 0.f, 0.f));
+			AActor* Wall = TestWorld.GetWorld()->SpawnActor<AActor>();
+
+			const TArray<FHitResult> Hits = {
+				FHitResult(Wall, nullptr, FVector(100.f, 0.f, 0.f), FVector::UpVector),
+				MakeHit(Target, FVector(200.f, 0.f, 0.f))
+			};
+
+			Shooter.Blaster->ApplyMultiHitDischarge(Params, FVector::ZeroVector, Hits);
+
+			TestEqual(TEXT("Target damage, first in the chain"), GetDamageTaken(Target), 10.f);
+		});
+	});
+
+
+	Describe("Native discharge", [this]()
+	{
+		It("should damage the pawns in its radius except the instigator", [this]()
+		{
+			Shooter.Backpack->InsertNewBattery(APUTestBatteryNative::StaticClass(), Shooter.Backpack->GetCurrentBatteryIndex());
+
+			FPUTestShooter Bystander = TestWorld.SpawnShooter(false);
+			Bystander.Character->SetActorLocation(FVector(300.f, 0.f, 0.f));
+
+			// Lands between the two, so the radius reaches both
+			FHitResult HitScanResult;
+			HitScanResult.Location = FVector(150.f, 0.f, 0.f);
+
+			Shooter.Blaster->Discharge(HitScanResult);
+
+			TestEqual(TEXT("Bystander damage"), GetDamageTaken(Bystander.ASC), 1.f);
+			TestEqual(TEXT("Instigator damage"), GetDamageTaken(Shooter.ASC), 0.f);
+		});
+	});
+
+
+	Describe("Upgrade dispatch", [this]()
+	{
+		It("should activate the typed and any type upgrades of a typed battery once each", [this]()
+		{
+			const FGameplayTag BatteryTypeTag = Shooter.Backpack->GetCurrentBattery()->GetBatteryTypeTag();
+
+			const FGameplayAbilitySpecHandle TypeUpgrade = Shooter.Blaster->GiveDischargeUpgrade(UPUTestUpgradeAbility::StaticClass(), BatteryTypeTag, TAG_PU_Test_Event_Discharge);
+			const FGameplayAbilitySpecHandle AnyTypeUpgrade = Shooter.Blaster->GiveDischargeUpgrade(UPUTestUpgradeAbility::StaticClass(), FGameplayTag::EmptyTag, TAG_PU_Test_Event_Discharge);
+
+			Shooter.Blaster->Discharge(FHitResult());
+
+			TestEqual(TEXT("Type upgrade activations"), GetUpgradeActivations(TypeUpgrade), 1);
+			TestEqual(TEXT("Any type upgrade activations"), GetUpgradeActivations(AnyTypeUpgrade), 1);
+		});
+
+		It("should activate the any type upgrades of an untyped battery once", [this]()
+		{
+			Shooter.Backpack->InsertNewBattery(APUTestBatteryUntyped::StaticClass(), Shooter.Backpack->GetCurrentBatteryIndex());
+
+			const FGameplayAbilitySpecHandle AnyTypeUpgrade = Shooter.Blaster->GiveDischargeUpgrade(UPUTestUpgradeAbility::StaticClass(), FGameplayTag::EmptyTag, TAG_PU_Test_Event_Discharge);
+
+			Shooter.Blaster->Discharge(FHitResult());
+
+			TestEqual(TEXT("Any type upgrade activations"), GetUpgradeActivations(AnyTypeUpgrade), 1);
+		});
+	});
+}
+
+#endif
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectUnrest/Actors/MultiHitDischarge.h"
+#include "Math/VectorRegister.h"
+
+
+
+void FMultiHitDischargeBatch::Reset(int32 NumTargets)
+{
+	Num = NumTargets;
+
+	const int32 PaddedNum = Align(NumTargets, 4);
+
+	for (TArray<float>* Array : { &X, &Y, &Z, &Distances, &Damages })
+	{
+		Array->SetNumUninitialized(PaddedNum);
+
+		for (int32 i = NumTargets; i < PaddedNum; i++)
+		{
+			(*Array)[i] = 0.f;
+		}
+	}
+
+	ChainOrder.SetNumUninitialized(NumTargets);
+}
+
+void FMultiHitDischargeBatch::SetTarget(int32 Index, const FVector& RelativeLocation)
+{
+	X[Index] = RelativeLocation.X;
+	Y[Index] = RelativeLocation.Y;
+	Z[Index] = RelativeLocation.Z;
+}
+
+void FMultiHitDischargeBatch::Compute(const FMultiHitDischargeParams& Params)
+{
+	const float FalloffRange = FMath::Max(Params.FalloffEndDistance - Params.FalloffStartDistance, UE_KINDA_SMALL_NUMBER);
+
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float One = VectorOneFloat();
+	const VectorRegister4Float FalloffStart = VectorSetFloat1(Params.FalloffStartDistance);
+	const VectorRegister4Float InvFalloffRange = VectorSetFloat1(1.f / FalloffRange);
+	const VectorRegister4Float FalloffDepth = VectorSetFloat1(1.f - Params.MinFalloffScale);
+	const VectorRegister4Float BaseDamage = VectorSetFloat1(Params.BaseDamage);
+
+	for (int32 i = 0; i < X.Num(); i += 4)
+	{
+		const VectorRegister4Float PosX = VectorLoad(&X[i]);
+		const VectorRegister4Float PosY = VectorLoad(&Y[i]);
+		const VectorRegister4Float PosZ = VectorLoad(&Z[i]);
+
+		const VectorRegister4Float DistanceSquared = VectorMultiplyAdd(PosZ, PosZ, VectorMultiplyAdd(PosY, PosY, VectorMultiply(PosX, PosX)));
+		const VectorRegister4Float Distance = VectorSqrt(DistanceSquared);
+
+		// Scale goes linearly from one at the falloff start to MinFalloffScale at the falloff end
+		const VectorRegister4Float Alpha = VectorMin(VectorMax(VectorMultiply(VectorSubtract(Distance, FalloffStart), InvFalloffRange), Zero), One);
+		const VectorRegister4Float Scale = VectorNegateMultiplyAdd(Alpha, FalloffDepth, One);
+
+		VectorStore(Distance, &Distances[i]);
+		VectorStore(VectorMultiply(Scale, BaseDamage), &Damages[i]);
+	}
+
+
+	for (int32 i = 0; i < Num; i++)
+	{
+		ChainOrder[i] = i;
+	}
+
+	ChainOrder.Sort([this](int32 A, int32 B) { return Distances[A] < Distances[B]; });
+
+	if (Params.ChainDamageScale != 1.f)
+	{
+		float ChainScale = 1.f;
+
+		for (int32 TargetIndex : ChainOrder)
+		{
+			Damages[TargetIndex] *= ChainScale;
+			ChainScale *= Params.ChainDamageScale;
+		}
+	}
+}
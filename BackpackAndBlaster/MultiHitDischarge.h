@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Templates/SubclassOf.h"
+#include "MultiHitDischarge.generated.h"
+
+
+class UGameplayEffect;
+
+
+/* How the damage of a piercing or chaining discharge is distributed between its targets */
+USTRUCT(BlueprintType)
+struct FMultiHitDischargeParams
+{
+	GENERATED_BODY()
+
+	/* The effect applied to every target, with its damage set by caller */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Multi Hit Discharge")
+	TSubclassOf<UGameplayEffect> DamageEffect;
+
+	/* The set by caller tag the damage is passed to DamageEffect with */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Multi Hit Discharge")
+	FGameplayTag DamageSetByCallerTag;
+
+	/* The damage of a target at or within FalloffStartDistance */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Multi Hit Discharge")
+	float BaseDamage = 0.f;
+
+	/* Distance from the origin at which damage starts to fall off */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Multi Hit Discharge")
+	float FalloffStartDistance = 0.f;
+
+	/* Distance from the origin at which damage is scaled down to MinFalloffScale */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Multi Hit Discharge")
+	float FalloffEndDistance = 1000.f;
+
+	/* The lowest falloff damage scale, reached at FalloffEndDistance */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Multi Hit Discharge")
+	float MinFalloffScale = 0.f;
+
+	/* Damage scale compounded per link of the chain, which is ordered by distance from the origin. 1 for piercing. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Multi Hit Discharge")
+	float ChainDamageScale = 1.f;
+};
+
+
+/*
+ *	Structure-of-arrays batch of target positions relative to the discharge origin. Computes falloff and damage four targets at
+ *	a time with vector registers, then the chain order. Meant to be reused between discharges to avoid reallocating.
+ */
+struct PROJECTUNREST_API FMultiHitDischargeBatch
+{
+	/* Target positions relative to the origin, padded with zeros to a multiple of four */
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Z;
+
+	/* Outputs of Compute, with the same padding */
+	TArray<float> Distances;
+	TArray<float> Damages;
+
+	/* Target indices from closest to furthest */
+	TArray<int32> ChainOrder;
+
+	int32 Num = 0;
+
+
+	/* Sizes the arrays for the given number of targets and zeros the padding */
+	void Reset(int32 NumTargets);
+
+	void SetTarget(int32 Index, const FVector& RelativeLocation);
+
+	/* Fills Distances, Damages and ChainOrder */
+	void Compute(const FMultiHitDischargeParams& Params);
+};
@@ -0,0 +1,382 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ProjectUnrest/Actors/ShootLoopTestFixture.h"
+#include "ProjectUnrest/Actors/ShootLoopTestTypes.h"
+#include "ProjectUnrest/Actors/Backpack.h"
+#include "ProjectUnrest/Actors/Battery.h"
+#include "ProjectUnrest/Actors/PUBlaster.h"
+#include "ProjectUnrest/GAS/AbilityRechargeComponent.h"
+#include "ProjectUnrest/GAS/Abilities/AbilityRecharger.h"
+#include "ProjectUnrest/GAS/PUAbilitySystemComponent.h"
+#include "ProjectUnrest/Telemetry/PUPerfResults.h"
+#include "RenderingThread.h"
+
+
+/*
+ *	Times the hot paths of the shoot loop in nanoseconds per call and appends them to the perf results file. Only the timed call runs
+ *	between the timestamps; restoring state for the next call (e.g. recharging the battery that was just discharged) is untimed.
+ */
+BEGIN_DEFINE_SPEC(FPUShootLoopPerfSpec, "ProjectUnrest.Perf.ShootLoop", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+	FPUShootLoopTestWorld TestWorld;
+
+	FPUTestShooter Shooter;
+
+	const int32 Iterations = 10000;
+
+	const FString Suite = TEXT("ShootLoop");
+
+	/* A save and restore of a shooter must fit in this budget, so a checkpoint or late-join catch-up doesn't hitch the frame */
+	const double SnapshotBudgetUs = 20.0;
+
+	/* Discharges every shooter's current battery, then rechambers or reloads directly, as Rechamber_BP and Reload_BP would */
+	static void ShootAll(const TArray<FPUTestShooter>& Shooters);
+
+END_DEFINE_SPEC(FPUShootLoopPerfSpec)
+
+void FPUShootLoopPerfSpec::ShootAll(const TArray<FPUTestShooter>& Shooters)
+{
+	for (const FPUTestShooter& Shooter : Shooters)
+	{
+		Shooter.Blaster->Discharge(FHitResult());
+
+		if (Shooter.Backpack->GetCurrentBatteryIndex() < FPUShootLoopTestWorld::BatteriesPerBackpack - 1)
+		{
+			Shooter.Backpack->CompleteRechamber();
+		}
+		else
+		{
+			Shooter.Backpack->CompleteReload();
+		}
+	}
+}
+
+
+void FPUShootLoopPerfSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		TestWorld.Create();
+
+		// Times the gameplay cost alone, as on a server or for a far away shooter
+		Shooter = TestWorld.SpawnShooter(false);
+	});
+
+	AfterEach([this]()
+	{
+		TestWorld.Destroy();
+	});
+
+
+	Describe("Discharge", [this]()
+	{
+		/*
+		 *	The same shot with a battery that gives and activates its discharge ability, and with one that applies its native descriptor's
+		 *	effect. A bystander stands within the native battery's radius of the hit, so the native shot applies its effect once.
+		 */
+		for (const bool bNative : { false, true })
+		{
+			It(bNative ? TEXT("Native battery") : TEXT("Ability battery"), [this, bNative]()
+			{
+				if (bNative)
+				{
+					Shooter.Backpack->InsertNewBattery(APUTestBatteryNative::StaticClass(), Shooter.Backpack->GetCurrentBatteryIndex());
+				}
+
+				FPUTestShooter Bystander = TestWorld.SpawnShooter(false);
+				Bystander.Character->SetActorLocation(FVector(300.f, 0.f, 0.f));
+
+				FHitResult HitScanResult;
+				HitScanResult.Location = FVector(150.f, 0.f, 0.f);
+
+				const double NsPerCall = FPUPerfResults::MeasureNsPerCall(Iterations,
+					[this]()
+					{
+						Shooter.Backpack->GetMutableBatteryAtIndex(Shooter.Backpack->GetCurrentBatteryIndex())->SetChargeImmediate(true);
+					},
+					[this, &HitScanResult]()
+					{
+						Shooter.Blaster->Discharge(HitScanResult);
+					});
+
+				// The ability battery keeps the metric name from before native discharges, so its history carries on
+				FPUPerfResults::Write(Suite, bNative ? TEXT("DischargeNativeNs") : TEXT("DischargeNs"), NsPerCall, TEXT("ns"));
+				TestTrue(TEXT("Measured discharge"), NsPerCall > 0.0);
+
+				if (bNative)
+				{
+					TestTrue(TEXT("Bystander damaged"), Bystander.ASC->GetNumericAttribute(UPUTestAttributeSet::GetDamageTakenAttribute()) > 0.f);
+				}
+			});
+		}
+	});
+
+	It("Reload_CPP", [this]()
+	{
+		const double NsPerCall = FPUPerfResults::MeasureNsPerCall(Iterations,
+			[this]()
+			{
+				for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack; i++)
+				{
+					Shooter.Backpack->GetMutableBatteryAtIndex(i)->SetChargeImmediate(false);
+				}
+			},
+			[this]()
+			{
+				Shooter.Backpack->CompleteReload();
+			});
+
+		FPUPerfResults::Write(Suite, TEXT("ReloadNs"), NsPerCall, TEXT("ns"));
+		TestTrue(TEXT("Reload invariants hold"), Shooter.Backpack->CheckInvariants());
+	});
+
+	It("Recharge", [this]()
+	{
+		// One charge per recharge, due immediately, so each call starts the pool and applies the increment effect
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetMaxChargesAttribute(), 1.f);
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetRechargeDurationAttribute(), 0.f);
+
+		Shooter.RechargeComponent->AddPool(FPUShootLoopTestWorld::MakeRechargePool());
+
+		const double NsPerCall = FPUPerfResults::MeasureNsPerCall(Iterations,
+			[this]()
+			{
+				Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetChargesAttribute(), 0.f);
+			},
+			[this]()
+			{
+				Shooter.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge);
+				Shooter.RechargeComponent->ExecuteRecharges();
+			});
+
+		FPUPerfResults::Write(Suite, TEXT("RechargeNs"), NsPerCall, TEXT("ns"));
+		TestFalse(TEXT("Pool stopped at max charges"), Shooter.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge));
+	});
+
+	It("StackingActivation", [this]()
+	{
+		// Spends a charge and tries to start the recharger, which returns on the recharge tag after the first activation
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetMaxChargesAttribute(), 3.f);
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetRechargeDurationAttribute(), 1.f);
+
+		const FGameplayAbilitySpecHandle StackingAbilityHandle = Shooter.ASC->GiveAbility(FGameplayAbilitySpec(UPUTestStackingAbility::StaticClass()));
+
+		const double NsPerCall = FPUPerfResults::MeasureNsPerCall(Iterations,
+			[this]()
+			{
+				Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetChargesAttribute(), 2.f);
+			},
+			[this, StackingAbilityHandle]()
+			{
+				Shooter.ASC->TryActivateAbility(StackingAbilityHandle);
+			});
+
+		FPUPerfResults::Write(Suite, TEXT("StackingActivationNs"), NsPerCall, TEXT("ns"));
+		TestTrue(TEXT("Recharging"), Shooter.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge));
+	});
+
+	It("TryStartRecharge", [this]()
+	{
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetMaxChargesAttribute(), 3.f);
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetChargesAttribute(), 0.f);
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetRechargeDurationAttribute(), 1.f);
+
+		// Times the common case, where the owner is already recharging and only the tag is checked
+		UAbilityRecharger::TryStartRecharge(Shooter.ASC, UPUTestAbilityRecharger::StaticClass());
+
+		const double NsPerCall = FPUPerfResults::MeasureNsPerCall(Iterations,
+			[this]()
+			{
+				UAbilityRecharger::TryStartRecharge(Shooter.ASC, UPUTestAbilityRecharger::StaticClass());
+			});
+
+		FPUPerfResults::Write(Suite, TEXT("TryStartRechargeNs"), NsPerCall, TEXT("ns"));
+		TestTrue(TEXT("Recharging"), Shooter.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge));
+	});
+
+	It("SnapshotRoundTrip", [this]()
+	{
+		// Two batteries are discharged and the pool is mid-recharge, so the restore sets charges and overwrites the recharge progress
+		Shooter.Blaster->Discharge(FHitResult());
+		Shooter.Backpack->GetMutableBatteryAtIndex(1)->SetChargeImmediate(false);
+
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetMaxChargesAttribute(), 3.f);
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetChargesAttribute(), 0.f);
+		Shooter.ASC->SetNumericAttributeBase(UPUTestAttributeSet::GetRechargeDurationAttribute(), 1.f);
+
+		Shooter.RechargeComponent->AddPool(FPUShootLoopTestWorld::MakeRechargePool());
+		Shooter.RechargeComponent->StartRecharge(TAG_PU_Test_Recharge);
+
+		TArray<uint8> BackpackSnapshot;
+		TArray<uint8> RechargeSnapshot;
+
+		const double SaveNs = FPUPerfResults::MeasureNsPerCall(Iterations, [this, &BackpackSnapshot, &RechargeSnapshot]()
+		{
+			Shooter.Backpack->SaveSnapshot(BackpackSnapshot);
+			Shooter.RechargeComponent->SaveSnapshot(RechargeSnapshot);
+		});
+
+		const double RestoreNs = FPUPerfResults::MeasureNsPerCall(Iterations, [this, &BackpackSnapshot, &RechargeSnapshot]()
+		{
+			Shooter.Backpack->RestoreSnapshot(BackpackSnapshot);
+			Shooter.RechargeComponent->RestoreSnapshot(RechargeSnapshot);
+		});
+
+		const double RoundTripUs = (SaveNs + RestoreNs) / 1000.0;
+
+		FPUPerfResults::Write(Suite, TEXT("SnapshotSaveNs"), SaveNs, TEXT("ns"));
+		FPUPerfResults::Write(Suite, TEXT("SnapshotRestoreNs"), RestoreNs, TEXT("ns"));
+		FPUPerfResults::Write(Suite, TEXT("SnapshotRoundTripUs"), RoundTripUs, TEXT("us"));
+
+		// Timings vary between machines, so going over the budget is reported rather than failed
+		if (RoundTripUs > SnapshotBudgetUs)
+		{
+			AddWarning(FString::Printf(TEXT("Snapshot round trip took %.2fus, over the %.2fus budget"), RoundTripUs, SnapshotBudgetUs));
+		}
+
+		TestTrue(TEXT("Restored invariants hold"), Shooter.Backpack->CheckInvariants());
+		TestTrue(TEXT("Recharging"), Shooter.RechargeComponent->IsRecharging(TAG_PU_Test_Recharge));
+	});
+
+	Describe("Scaling", [this]()
+	{
+		/*
+		 *	Every shooter fires once per frame, first with insignificant visuals, as far away or on a server, then with significant ones.
+		 *	The game thread time covers the shots, the world tick and sending the render state updates. The render thread time is how
+		 *	long the rendering commands a frame queued take to drain, so it covers the render thread's work for the shoot loop alone.
+		 */
+		It("100 shooters", [this]()
+		{
+			const int32 NumShooters = 100;
+			const int32 Frames = 300;
+			const float TickDelta = 1.f / 60.f;
+
+			TArray<FPUTestShooter> Shooters = { Shooter };
+
+			while (Shooters.Num() < NumShooters)
+			{
+				Shooters.Add(TestWorld.SpawnShooter(false));
+			}
+
+			for (const bool bSignificant : { false, true })
+			{
+				for (const FPUTestShooter& Each : Shooters)
+				{
+					Each.Backpack->SetVisualsSignificant(bSignificant);
+					Each.Blaster->SetVisualsSignificant(bSignificant);
+				}
+
+				auto RunFrame = [this, &Shooters, TickDelta]()
+				{
+					ShootAll(Shooters);
+					TestWorld.Tick(TickDelta);
+					TestWorld.GetWorld()->SendAllEndOfFrameUpdates();
+				};
+
+				// Each frame starts with the render thread idle, so the game thread isn't timed waiting on it
+				const double GameThreadNs = FPUPerfResults::MeasureNsPerCall(Frames, []() { FlushRenderingCommands(); }, RunFrame);
+				const double RenderThreadNs = FPUPerfResults::MeasureNsPerCall(Frames, RunFrame, []() { FlushRenderingCommands(); });
+
+				const TCHAR* Mode = bSignificant ? TEXT("Significant") : TEXT("Insignificant");
+
+				FPUPerfResults::Write(Suite, FString::Printf(TEXT("Shooters%dGameThreadUs_%s"), NumShooters, Mode), GameThreadNs / 1000.0, TEXT("us"));
+				FPUPerfResults::Write(Suite, FString::Printf(TEXT("Shooters%dRenderThreadUs_%s"), NumShooters, Mode), RenderThreadNs / 1000.0, TEXT("us"));
+
+				TestTrue(FString::Printf(TEXT("Measured %s frames"), Mode), GameThreadNs > 0.0);
+			}
+
+			for (const FPUTestShooter& Each : Shooters)
+			{
+				TestTrue(TEXT("Invariants hold"), Each.Backpack->CheckInvariants());
+			}
+		});
+	});
+
+
+	Describe("MultiHitDischarge", [this]()
+	{
+		for (const int32 TargetCount : { 1, 16, 256 })
+		{
+			// Each target is hit twice, as by a piercing trace through two of its components, so the ASCs are deduplicated too
+			It(FString::Printf(TEXT("%d targets"), TargetCount), [this, TargetCount]()
+			{
+				TArray<FHitResult> Hits;
+
+				for (int32 i = 0; i < TargetCount; i++)
+				{
+					const FVector Location(100.f + i * 10.f, 0.f, 0.f);
+					UAbilitySystemComponent* TargetASC = TestWorld.SpawnTarget(Location);
+
+					Hits.Emplace(TargetASC->GetOwner(), nullptr, Location, FVector::UpVector);
+					Hits.Emplace(TargetASC->GetOwner(), nullptr, Location + FVector(5.f, 0.f, 0.f), FVector::UpVector);
+				}
+
+				FMultiHitDischargeParams Params;
+				Params.DamageEffect = UPUTestDamageEffect::StaticClass();
+				Params.DamageSetByCallerTag = TAG_PU_Test_SetByCaller_Damage;
+				Params.BaseDamage = 10.f;
+				Params.FalloffStartDistance = 500.f;
+				Params.FalloffEndDistance = 3000.f;
+				Params.ChainDamageScale = 0.9f;
+
+				const double NsPerCall = FPUPerfResults::MeasureNsPerCall(FMath::Max(Iterations / TargetCount, 100), [this, &Params, &Hits]()
+				{
+					Shooter.Blaster->ApplyMultiHitDischarge(Params, FVector::ZeroVector, Hits);
+				});
+
+				FPUPerfResults::Write(Suite, FString::Printf(TEXT("MultiHitDischarge%dNs"), TargetCount), NsPerCall, TEXT("ns"));
+				FPUPerfResults::Write(Suite, FString::Printf(TEXT("MultiHitDischarge%dNsPerTarget"), TargetCount), NsPerCall / TargetCount, TEXT("ns"));
+
+				TestTrue(TEXT("Measured multi-hit discharge"), NsPerCall > 0.0);
+			});
+		}
+	});
+
+	Describe("UpgradeDispatch", [this]()
+	{
+		for (const int32 UpgradeCount : { 10, 50, 200 })
+		{
+			/*
+			 *	The upgrades are given for every battery type, so each event activates all of them. The dispatched upgrades are compared
+			 *	against the same number of upgrades triggered by the discharge event through HandleGameplayEvent.
+			 */
+			It(FString::Printf(TEXT("%d upgrades"), UpgradeCount), [this, UpgradeCount]()
+			{
+				FPUTestShooter TriggeredShooter = TestWorld.SpawnShooter(false);
+
+				for (int32 i = 0; i < UpgradeCount; i++)
+				{
+					Shooter.Blaster->GiveDischargeUpgrade(UPUTestUpgradeAbility::StaticClass(), FGameplayTag::EmptyTag, TAG_PU_Test_Event_Discharge);
+					TriggeredShooter.ASC->GiveAbility(FGameplayAbilitySpec(UPUTestTriggeredUpgradeAbility::StaticClass()));
+				}
+
+				FGameplayEventData EventData;
+				EventData.EventTag = TAG_PU_Test_Event_Discharge;
+
+				const int32 DispatchIterations = Iterations / UpgradeCount;
+
+				const double DispatchNs = FPUPerfResults::MeasureNsPerCall(DispatchIterations, [this, &EventData]()
+				{
+					Shooter.Blaster->DispatchUpgradeEvent(TAG_PU_Test_Battery_Red, TAG_PU_Test_Event_Discharge, EventData);
+				});
+
+				const double TriggeredNs = FPUPerfResults::MeasureNsPerCall(DispatchIterations, [&TriggeredShooter, &EventData]()
+				{
+					TriggeredShooter.ASC->HandleGameplayEvent(TAG_PU_Test_Event_Discharge, &EventData);
+				});
+
+				FPUPerfResults::Write(Suite, FString::Printf(TEXT("UpgradeDispatch%dNs"), UpgradeCount), DispatchNs, TEXT("ns"));
+				FPUPerfResults::Write(Suite, FString::Printf(TEXT("UpgradeTriggered%dNs"), UpgradeCount), TriggeredNs, TEXT("ns"));
+
+				TestTrue(TEXT("Measured dispatch"), DispatchNs > 0.0 && TriggeredNs > 0.0);
+			});
+		}
+	});
+}
+
+#endif
@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectUnrest/Actors/ShootLoopTestFixture.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ProjectUnrest/Actors/ShootLoopTestTypes.h"
+#include "ProjectUnrest/Actors/Backpack.h"
+#include "ProjectUnrest/Actors/Battery.h"
+#include "ProjectUnrest/Actors/PUBlaster.h"
+#include "ProjectUnrest/GAS/PUAbilitySystemComponent.h"
+#include "ProjectUnrest/GAS/AbilityRechargeComponent.h"
+#include "GameFramework/Character.h"
+#include "Engine/Engine.h"
+
+
+UE_DEFINE_GAMEPLAY_TAG(TAG_PU_Test_Battery_Red, "PU.Test.Battery.Red");
+UE_DEFINE_GAMEPLAY_TAG(TAG_PU_Test_Battery_Green, "PU.Test.Battery.Green");
+UE_DEFINE_GAMEPLAY_TAG(TAG_PU_Test_Battery_Blue, "PU.Test.Battery.Blue");
+UE_DEFINE_GAMEPLAY_TAG(TAG_PU_Test_Event_Discharge, "PU.Test.Event.Discharge");
+UE_DEFINE_GAMEPLAY_TAG(TAG_PU_Test_Recharge, "PU.Test.Recharge");
+UE_DEFINE_GAMEPLAY_TAG(TAG_PU_Test_Parameter_Damage, "PU.Test.Parameter.Damage");
+UE_DEFINE_GAMEPLAY_TAG(TAG_PU_Test_SetByCaller_Damage, "PU.Test.SetByCaller.Damage");
+
+
+
+#pragma region === FPUShootLoopTestWorld ===
+
+const TArray<TSubclassOf<ABattery>>& FPUShootLoopTestWorld::GetBatteryTypes()
+{
+	static const TArray<TSubclassOf<ABattery>> BatteryTypes = {
+		APUTestBatteryRed::StaticClass(),
+		APUTestBatteryGreen::StaticClass(),
+		APUTestBatteryBlue::StaticClass()
+	};
+
+	return BatteryTypes;
+}
+
+FRechargePool FPUShootLoopTestWorld::MakeRechargePool()
+{
+	FRechargePool Pool;
+	Pool.ChargesAttribute = UPUTestAttributeSet::GetChargesAttribute();
+	Pool.MaxChargesAttribute = UPUTestAttributeSet::GetMaxChargesAttribute();
+	Pool.RechargeDurationAttribute = UPUTestAttributeSet::GetRechargeDurationAttribute();
+	Pool.RechargeTag = TAG_PU_Test_Recharge;
+
+	return Pool;
+}
+
+void FPUShootLoopTestWorld::Create()
+{
+	check(World == nullptr);
+
+	World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("PUShootLoopTestWorld"));
+
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+}
+
+void FPUShootLoopTestWorld::Destroy()
+{
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	World = nullptr;
+}
+
+UWorld* FPUShootLoopTestWorld::GetWorld() const
+{
+	return World;
+}
+
+FPUTestShooter FPUShootLoopTestWorld::SpawnShooter(bool bVisualsSignificant)
+{
+	check(World);
+
+	FPUTestShooter Shooter;
+
+	Shooter.Character = World->SpawnActor<ACharacter>();
+	check(Shooter.Character);
+
+	Shooter.ASC = NewObject<UPUAbilitySystemComponent>(Shooter.Character);
+	Shooter.ASC->RegisterComponent();
+	Shooter.ASC->AddAttributeSetSubobject(NewObject<UPUTestAttributeSet>(Shooter.Character));
+	Shooter.ASC->InitAbilityActorInfo(Shooter.Character, Shooter.Character);
+
+	Shooter.RechargeComponent = NewObject<UPUTestAbilityRechargeComponent>(Shooter.Character);
+	Shooter.RechargeComponent->RegisterComponent();
+	Shooter.RechargeComponent->Init(Shooter.ASC);
+
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = Shooter.Character;
+
+	Shooter.Backpack = World->SpawnActor<APUTestBackpack>(SpawnParameters);
+	check(Shooter.Backpack);
+
+	Shooter.Backpack->Init(Shooter.Character, Shooter.ASC);
+
+	Shooter.Blaster = World->SpawnActor<APUTestBlaster>(SpawnParameters);
+	check(Shooter.Blaster);
+
+	Shooter.Blaster->Init(Shooter.ASC, Shooter.Backpack);
+
+
+	// Set after init, so that it applies to the initial batteries
+	if (!bVisualsSignificant)
+	{
+		Shooter.Backpack->SetVisualsSignificant(false);
+		Shooter.Blaster->SetVisualsSignificant(false);
+	}
+
+	return Shooter;
+}
+
+UAbilitySystemComponent* FPUShootLoopTestWorld::SpawnTarget(const FVector& Location)
+{
+	check(World);
+
+	AActor* Target = World->SpawnActor<AActor>();
+	check(Target);
+
+	USceneComponent* Root = NewObject<USceneComponent>(Target);
+	Root->RegisterComponent();
+	Target->SetRootComponent(Root);
+	Target->SetActorLocation(Location);
+
+	// Found by UAbilitySystemGlobals::GetAbilitySystemComponentFromActor as the actor's component
+	UAbilitySystemComponent* TargetASC = NewObject<UAbilitySystemComponent>(Target);
+	TargetASC->RegisterComponent();
+	TargetASC->AddAttributeSetSubobject(NewObject<UPUTestAttributeSet>(Target));
+	TargetASC->InitAbilityActorInfo(Target, Target);
+
+	return TargetASC;
+}
+
+void FPUShootLoopTestWorld::Tick(float DeltaSeconds, int32 Steps)
+{
+	check(World);
+
+	for (int32 i = 0; i < Steps; i++)
+	{
+		// The timer manager only ticks once per engine frame
+		++GFrameCounter;
+
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+	}
+}
+
+bool FPUShootLoopTestWorld::TickUntil(TFunctionRef<bool()> Predicate, float MaxSeconds, float DeltaSeconds)
+{
+	for (float Elapsed = 0.f; !Predicate(); Elapsed += DeltaSeconds)
+	{
+		if (Elapsed >= MaxSeconds)
+		{
+			return false;
+		}
+
+		Tick(DeltaSeconds);
+	}
+
+	return true;
+}
+
+#pragma endregion
+
+#endif
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "GameplayTagContainer.h"
+#include "NativeGameplayTags.h"
+#include "Templates/SubclassOf.h"
+
+
+class ACharacter;
+class ABattery;
+class APUTestBackpack;
+class APUTestBlaster;
+class UWorld;
+class UAbilitySystemComponent;
+class UPUAbilitySystemComponent;
+class UPUTestAbilityRechargeComponent;
+struct FRechargePool;
+
+
+UE_DECLARE_GAMEPLAY_TAG_EXTERN(TAG_PU_Test_Battery_Red);
+UE_DECLARE_GAMEPLAY_TAG_EXTERN(TAG_PU_Test_Battery_Green);
+UE_DECLARE_GAMEPLAY_TAG_EXTERN(TAG_PU_Test_Battery_Blue);
+UE_DECLARE_GAMEPLAY_TAG_EXTERN(TAG_PU_Test_Event_Discharge);
+UE_DECLARE_GAMEPLAY_TAG_EXTERN(TAG_PU_Test_Recharge);
+UE_DECLARE_GAMEPLAY_TAG_EXTERN(TAG_PU_Test_Parameter_Damage);
+UE_DECLARE_GAMEPLAY_TAG_EXTERN(TAG_PU_Test_SetByCaller_Damage);
+
+
+/* A character with an ASC, the test attribute set, a recharge component, a backpack and a blaster */
+struct FPUTestShooter
+{
+	ACharacter* Character = nullptr;
+
+	UPUAbilitySystemComponent* ASC = nullptr;
+
+	UPUTestAbilityRechargeComponent* RechargeComponent = nullptr;
+
+	APUTestBackpack* Backpack = nullptr;
+
+	APUTestBlaster* Blaster = nullptr;
+};
+
+
+/*
+ *	A game world for the shoot loop specs that runs headless (e.g. -nullrhi), populated with shooters built from the native test types.
+ *	World time only advances when ticked, so timings are deterministic.
+ */
+class FPUShootLoopTestWorld
+{
+public:
+	static constexpr int32 BatteriesPerBackpack = 6;
+
+	/* Stand in for the lengths of the rechamber and reload animations */
+	static constexpr float RechamberDuration = 0.25f;
+	static constexpr float ReloadDuration = 1.f;
+
+	/* The test battery types, in the order they fill a backpack */
+	static const TArray<TSubclassOf<ABattery>>& GetBatteryTypes();
+
+	/* Returns the pool of the test attribute set's charges, tagged with TAG_PU_Test_Recharge */
+	static FRechargePool MakeRechargePool();
+
+	/* Creates the world */
+	void Create();
+
+	/* Ends play and destroys the world along with every shooter */
+	void Destroy();
+
+	UWorld* GetWorld() const;
+
+	/*
+	 *	Spawns a shooter whose backpack cycles through the test battery types. Rechamber_BP and Reload_BP have no native implementation,
+	 *	so a shooter needs insignificant visuals to rechamber and reload on its own.
+	 */
+	FPUTestShooter SpawnShooter(bool bVisualsSignificant = true);
+
+	/* Spawns an actor with an ASC and the test attribute set at the location, to be hit by discharges. Returns its ASC. */
+	UAbilitySystemComponent* SpawnTarget(const FVector& Location);
+
+	/* Advances world time and timers by the given number of fixed steps */
+	void Tick(float DeltaSeconds, int32 Steps = 1);
+
+	/* Ticks until the predicate is true or MaxSeconds of world time have passed. Returns the predicate. */
+	bool TickUntil(TFunctionRef<bool()> Predicate, float MaxSeconds, float DeltaSeconds = 1.f / 60.f);
+
+
+private:
+	UWorld* World = nullptr;
+};
+
+#endif
@@ -0,0 +1,272 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectUnrest/Actors/ShootLoopTestTypes.h"
+#include "ProjectUnrest/Actors/ShootLoopTestFixture.h"
+#include "Engine/CurveTable.h"
+#include "EngineUtils.h"
+
+
+/*
+ *	The tags and constants the types configure themselves with only exist in builds with automation tests, where the classes still
+ *	have to be constructible, so the constructors leave them default without them.
+ */
+
+
+
+APUTestBatteryRed::APUTestBatteryRed()
+{
+#if WITH_DEV_AUTOMATION_TESTS
+	BatteryTypeTag = TAG_PU_Test_Battery_Red;
+#endif
+	DischargeAbility = UPUTestDischargeAbility::StaticClass();
+}
+
+APUTestBatteryGreen::APUTestBatteryGreen()
+{
+#if WITH_DEV_AUTOMATION_TESTS
+	BatteryTypeTag = TAG_PU_Test_Battery_Green;
+#endif
+	DischargeAbility = UPUTestDischargeAbility::StaticClass();
+}
+
+APUTestBatteryBlue::APUTestBatteryBlue()
+{
+#if WITH_DEV_AUTOMATION_TESTS
+	BatteryTypeTag = TAG_PU_Test_Battery_Blue;
+#endif
+	DischargeAbility = UPUTestDischargeAbility::StaticClass();
+}
+
+APUTestBatteryUntyped::APUTestBatteryUntyped()
+{
+	DischargeAbility = UPUTestDischargeAbility::StaticClass();
+}
+
+APUTestBatteryNative::APUTestBatteryNative()
+{
+	NativeDischarge.bEnabled = true;
+	NativeDischarge.Effects.Add(UPUTestNativeDamageEffect::StaticClass());
+	NativeDischarge.Radius = 1000.f;
+}
+
+APUTestBatteryParameterized::APUTestBatteryParameterized()
+{
+	DischargeAbility = UPUTestDischargeAbility::StaticClass();
+
+	DischargeCurveTable = CreateDefaultSubobject<UCurveTable>(TEXT("DischargeCurveTable"));
+
+#if WITH_DEV_AUTOMATION_TESTS
+	FScalableFloat DamageParameter(1.f);
+	DamageParameter.Curve.CurveTable = DischargeCurveTable;
+	DamageParameter.Curve.RowName = TEXT("Damage");
+
+	DischargeParameters.Add(TAG_PU_Test_Parameter_Damage, DamageParameter);
+#endif
+}
+
+UCurveTable* APUTestBatteryParameterized::GetDischargeCurveTable() const
+{
+	return DischargeCurveTable;
+}
+
+
+APUTestBackpack::APUTestBackpack()
+{
+	ReloadAbility = UPUTestReloadAbility::StaticClass();
+
+#if WITH_DEV_AUTOMATION_TESTS
+	OwnedBatteriesCount = FPUShootLoopTestWorld::BatteriesPerBackpack;
+	RechamberDuration = FPUShootLoopTestWorld::RechamberDuration;
+	ReloadDuration = FPUShootLoopTestWorld::ReloadDuration;
+
+	const TArray<TSubclassOf<ABattery>>& BatteryTypes = FPUShootLoopTestWorld::GetBatteryTypes();
+
+	// Fills the cylinder by cycling through the types, so every type has a count above one
+	for (int32 i = 0; i < OwnedBatteriesCount; i++)
+	{
+		InitialOwnedBatteryTypes.Add(BatteryTypes[i % BatteryTypes.Num()]);
+	}
+
+	SnapshotBatteryTypes = BatteryTypes;
+#endif
+}
+
+void APUTestBackpack::CompleteRechamber()
+{
+	Rechamber_CPP();
+}
+
+void APUTestBackpack::CompleteReload()
+{
+	Reload_CPP();
+}
+
+ABattery* APUTestBackpack::GetMutableBatteryAtIndex(int32 Index) const
+{
+	return OwnedBatteries[Index];
+}
+
+void APUTestBackpack::SetVisualsSignificant(bool bSignificant)
+{
+	Super::SetVisualsSignificant(bSignificant);
+}
+
+
+APUTestBlaster::APUTestBlaster()
+{
+#if WITH_DEV_AUTOMATION_TESTS
+	DischargeEventTag = TAG_PU_Test_Event_Discharge;
+#endif
+}
+
+void APUTestBlaster::DispatchUpgradeEvent(FGameplayTag BatteryTypeTag, FGameplayTag EventTag, const FGameplayEventData& EventData)
+{
+	Super::DispatchUpgradeEvent(BatteryTypeTag, EventTag, EventData);
+}
+
+void APUTestBlaster::SetVisualsSignificant(bool bSignificant)
+{
+	Super::SetVisualsSignificant(bSignificant);
+}
+
+
+void UPUTestAbilityRechargeComponent::ExecuteRecharges()
+{
+	Super::ExecuteRecharges();
+}
+
+int32 UPUTestAbilityRechargeComponent::GetPoolCount() const
+{
+	return Pools.Num();
+}
+
+
+UPUTestDischargeAbility::UPUTestDischargeAbility()
+{
+	// The blaster gives and activates discharge abilities once, which requires an instanced ability
+	InstancingPolicy = EGameplayAbilityInstancingPolicy::InstancedPerExecution;
+}
+
+void UPUTestDischargeAbility::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
+{
+	EndAbility(Handle, ActorInfo, ActivationInfo, true, false);
+}
+
+
+UPUTestReloadAbility::UPUTestReloadAbility()
+{
+	InstancingPolicy = EGameplayAbilityInstancingPolicy::InstancedPerExecution;
+}
+
+void UPUTestReloadAbility::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
+{
+	AActor* Avatar = ActorInfo->AvatarActor.Get();
+	check(Avatar);
+
+	for (TActorIterator<ABackpack> It(Avatar->GetWorld()); It; ++It)
+	{
+		if (It->GetOwner() == Avatar)
+		{
+			It->Reload_Exec();
+		}
+	}
+
+	EndAbility(Handle, ActorInfo, ActivationInfo, true, false);
+}
+
+
+UPUTestAbilityRecharger::UPUTestAbilityRecharger()
+{
+	ChargesAttribute = UPUTestAttributeSet::GetChargesAttribute();
+	MaxChargesAttribute = UPUTestAttributeSet::GetMaxChargesAttribute();
+	RechargeDurationAttribute = UPUTestAttributeSet::GetRechargeDurationAttribute();
+
+#if WITH_DEV_AUTOMATION_TESTS
+	RechargeTag = TAG_PU_Test_Recharge;
+#endif
+}
+
+
+UPUTestStackingAbility::UPUTestStackingAbility()
+{
+	InstancingPolicy = EGameplayAbilityInstancingPolicy::NonInstanced;
+}
+
+bool UPUTestStackingAbility::CanActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayTagContainer* SourceTags, const FGameplayTagContainer* TargetTags, FGameplayTagContainer* OptionalRelevantTags) const
+{
+	if (!Super::CanActivateAbility(Handle, ActorInfo, SourceTags, TargetTags, OptionalRelevantTags))
+	{
+		return false;
+	}
+
+	return ActorInfo->AbilitySystemComponent->GetNumericAttribute(UPUTestAttributeSet::GetChargesAttribute()) >= 1.f;
+}
+
+void UPUTestStackingAbility::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
+{
+	UAbilitySystemComponent* AbilitySystemComponent = ActorInfo->AbilitySystemComponent.Get();
+
+	AbilitySystemComponent->ApplyModToAttribute(UPUTestAttributeSet::GetChargesAttribute(), EGameplayModOp::Additive, -1.f);
+
+	// Returns before touching the recharge component while the recharge tag is present
+	UAbilityRecharger::TryStartRecharge(AbilitySystemComponent, UPUTestAbilityRecharger::StaticClass());
+
+	EndAbility(Handle, ActorInfo, ActivationInfo, true, false);
+}
+
+
+UPUTestUpgradeAbility::UPUTestUpgradeAbility()
+{
+	InstancingPolicy = EGameplayAbilityInstancingPolicy::InstancedPerActor;
+}
+
+void UPUTestUpgradeAbility::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
+{
+	ActivationCount++;
+
+	EndAbility(Handle, ActorInfo, ActivationInfo, true, false);
+}
+
+
+UPUTestTriggeredUpgradeAbility::UPUTestTriggeredUpgradeAbility()
+{
+#if WITH_DEV_AUTOMATION_TESTS
+	FAbilityTriggerData TriggerData;
+	TriggerData.TriggerTag = TAG_PU_Test_Event_Discharge;
+	TriggerData.TriggerSource = EGameplayAbilityTriggerSource::GameplayEvent;
+
+	AbilityTriggers.Add(TriggerData);
+#endif
+}
+
+
+UPUTestDamageEffect::UPUTestDamageEffect()
+{
+	DurationPolicy = EGameplayEffectDurationType::Instant;
+
+#if WITH_DEV_AUTOMATION_TESTS
+	FSetByCallerFloat SetByCallerDamage;
+	SetByCallerDamage.DataTag = TAG_PU_Test_SetByCaller_Damage;
+
+	FGameplayModifierInfo DamageModifier;
+	DamageModifier.Attribute = UPUTestAttributeSet::GetDamageTakenAttribute();
+	DamageModifier.ModifierOp = EGameplayModOp::Additive;
+	DamageModifier.ModifierMagnitude = FGameplayEffectModifierMagnitude(SetByCallerDamage);
+
+	Modifiers.Add(DamageModifier);
+#endif
+}
+
+
+UPUTestNativeDamageEffect::UPUTestNativeDamageEffect()
+{
+	DurationPolicy = EGameplayEffectDurationType::Instant;
+
+	FGameplayModifierInfo DamageModifier;
+	DamageModifier.Attribute = UPUTestAttributeSet::GetDamageTakenAttribute();
+	DamageModifier.ModifierOp = EGameplayModOp::Additive;
+	DamageModifier.ModifierMagnitude = FGameplayEffectModifierMagnitude(FScalableFloat(1.f));
+
+	Modifiers.Add(DamageModifier);
+}
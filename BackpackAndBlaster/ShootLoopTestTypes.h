@@ -0,0 +1,268 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AttributeSet.h"
+#include "AbilitySystemComponent.h"
+#include "GameplayEffect.h"
+#include "ProjectUnrest/Actors/Battery.h"
+#include "ProjectUnrest/Actors/Backpack.h"
+#include "ProjectUnrest/Actors/PUBlaster.h"
+#include "ProjectUnrest/GAS/PUGameplayAbility.h"
+#include "ProjectUnrest/GAS/AbilityRechargeComponent.h"
+#include "ProjectUnrest/GAS/Abilities/AbilityRecharger.h"
+#include "ShootLoopTestTypes.generated.h"
+
+
+/*
+ *	Native stand-ins for the content the shoot loop automation specs need, so that they run headless without loading any assets.
+ *	Each type configures itself in its constructor from the tags and constants of ShootLoopTestFixture.h. They shouldn't be used
+ *	outside of the specs, so they aren't exported from the module, can't be placed and are hidden from the editor's class pickers.
+ */
+
+
+class UCurveTable;
+
+
+/* The attributes of test shooters and targets */
+UCLASS(HideDropdown, Hidden)
+class UPUTestAttributeSet : public UAttributeSet
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY()
+	FGameplayAttributeData Charges;
+	GAMEPLAYATTRIBUTE_PROPERTY_GETTER(UPUTestAttributeSet, Charges)
+
+	UPROPERTY()
+	FGameplayAttributeData MaxCharges;
+	GAMEPLAYATTRIBUTE_PROPERTY_GETTER(UPUTestAttributeSet, MaxCharges)
+
+	UPROPERTY()
+	FGameplayAttributeData RechargeDuration;
+	GAMEPLAYATTRIBUTE_PROPERTY_GETTER(UPUTestAttributeSet, RechargeDuration)
+
+	UPROPERTY()
+	FGameplayAttributeData Health;
+	GAMEPLAYATTRIBUTE_PROPERTY_GETTER(UPUTestAttributeSet, Health)
+
+	/* The total damage a target has taken */
+	UPROPERTY()
+	FGameplayAttributeData DamageTaken;
+	GAMEPLAYATTRIBUTE_PROPERTY_GETTER(UPUTestAttributeSet, DamageTaken)
+};
+
+
+/* Test battery types, with the test discharge ability */
+UCLASS(NotBlueprintable, NotPlaceable, HideDropdown, Hidden)
+class APUTestBatteryRed : public ABattery
+{
+	GENERATED_BODY()
+
+public:
+	APUTestBatteryRed();
+};
+
+UCLASS(NotBlueprintable, NotPlaceable, HideDropdown, Hidden)
+class APUTestBatteryGreen : public ABattery
+{
+	GENERATED_BODY()
+
+public:
+	APUTestBatteryGreen();
+};
+
+UCLASS(NotBlueprintable, NotPlaceable, HideDropdown, Hidden)
+class APUTestBatteryBlue : public ABattery
+{
+	GENERATED_BODY()
+
+public:
+	APUTestBatteryBlue();
+};
+
+/* A battery without a type tag, which only matches upgrades given for every battery type */
+UCLASS(NotBlueprintable, NotPlaceable, HideDropdown, Hidden)
+class APUTestBatteryUntyped : public ABattery
+{
+	GENERATED_BODY()
+
+public:
+	APUTestBatteryUntyped();
+};
+
+/* A battery discharged natively, which applies UPUTestNativeDamageEffect to every pawn but the instigator within 1000 units of the hit */
+UCLASS(NotBlueprintable, NotPlaceable, HideDropdown, Hidden)
+class APUTestBatteryNative : public ABattery
+{
+	GENERATED_BODY()
+
+public:
+	APUTestBatteryNative();
+};
+
+/* A battery whose damage parameter reads the Damage row of its own curve table, which the battery specs fill */
+UCLASS(NotBlueprintable, NotPlaceable, HideDropdown, Hidden)
+class APUTestBatteryParameterized : public ABattery
+{
+	GENERATED_BODY()
+
+public:
+	APUTestBatteryParameterized();
+
+	UCurveTable* GetDischargeCurveTable() const;
+
+private:
+	UPROPERTY()
+	UCurveTable* DischargeCurveTable = nullptr;
+};
+
+
+/* A backpack that cycles through the test battery types, with the test reload ability and the test world's durations */
+UCLASS(NotBlueprintable, NotPlaceable, HideDropdown, Hidden)
+class APUTestBackpack : public ABackpack
+{
+	GENERATED_BODY()
+
+public:
+	APUTestBackpack();
+
+	/* Stand ins for Rechamber_BP and Reload_BP, which have no native implementation */
+	void CompleteRechamber();
+	void CompleteReload();
+
+	ABattery* GetMutableBatteryAtIndex(int32 Index) const;
+
+	void SetVisualsSignificant(bool bSignificant);
+};
+
+
+/* A blaster that sends the test discharge event */
+UCLASS(NotBlueprintable, NotPlaceable, HideDropdown, Hidden)
+class APUTestBlaster : public APUBlaster
+{
+	GENERATED_BODY()
+
+public:
+	APUTestBlaster();
+
+	void DispatchUpgradeEvent(FGameplayTag BatteryTypeTag, FGameplayTag EventTag, const FGameplayEventData& EventData);
+
+	void SetVisualsSignificant(bool bSignificant);
+};
+
+
+/* A recharge component whose recharges can be executed without waiting for the timer */
+UCLASS(HideDropdown, Hidden)
+class UPUTestAbilityRechargeComponent : public UAbilityRechargeComponent
+{
+	GENERATED_BODY()
+
+public:
+	void ExecuteRecharges();
+
+	int32 GetPoolCount() const;
+};
+
+
+/* Stands in for a discharge ability. Ends as soon as it is activated. */
+UCLASS(NotBlueprintable, HideDropdown, Hidden)
+class UPUTestDischargeAbility : public UPUGameplayAbility
+{
+	GENERATED_BODY()
+
+public:
+	UPUTestDischargeAbility();
+
+	virtual void ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData) override;
+};
+
+
+/* Stands in for the reload ability. Reloads the backpack owned by the avatar, then ends. */
+UCLASS(NotBlueprintable, HideDropdown, Hidden)
+class UPUTestReloadAbility : public UPUGameplayAbility
+{
+	GENERATED_BODY()
+
+public:
+	UPUTestReloadAbility();
+
+	virtual void ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData) override;
+};
+
+
+/* Recharges the test attribute set's charges, tagged with TAG_PU_Test_Recharge */
+UCLASS(NotBlueprintable, HideDropdown, Hidden)
+class UPUTestAbilityRecharger : public UAbilityRecharger
+{
+	GENERATED_BODY()
+
+public:
+	UPUTestAbilityRecharger();
+};
+
+
+/* A non-instanced stacking ability. Spends a charge, then starts the test recharger through TryStartRecharge like a shoot ability would. */
+UCLASS(NotBlueprintable, HideDropdown, Hidden)
+class UPUTestStackingAbility : public UGameplayAbility
+{
+	GENERATED_BODY()
+
+public:
+	UPUTestStackingAbility();
+
+	virtual bool CanActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayTagContainer* SourceTags, const FGameplayTagContainer* TargetTags, FGameplayTagContainer* OptionalRelevantTags) const override;
+
+	virtual void ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData) override;
+};
+
+
+/* Stands in for a discharge upgrade given with APUBlaster::GiveDischargeUpgrade. Counts its activations and ends as soon as it is activated. */
+UCLASS(NotBlueprintable, HideDropdown, Hidden)
+class UPUTestUpgradeAbility : public UPUGameplayAbility
+{
+	GENERATED_BODY()
+
+public:
+	UPUTestUpgradeAbility();
+
+	virtual void ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData) override;
+
+	/* Activations of this instance, which is per actor, so per upgrade given */
+	int32 ActivationCount = 0;
+};
+
+
+/* An upgrade that is still triggered by the test discharge event, as upgrades were before the blaster dispatched them */
+UCLASS(NotBlueprintable, HideDropdown, Hidden)
+class UPUTestTriggeredUpgradeAbility : public UPUTestUpgradeAbility
+{
+	GENERATED_BODY()
+
+public:
+	UPUTestTriggeredUpgradeAbility();
+};
+
+
+/* A multi-hit damage effect, which adds its set by caller damage, passed with TAG_PU_Test_SetByCaller_Damage, to the target's DamageTaken */
+UCLASS(NotBlueprintable, HideDropdown, Hidden)
+class UPUTestDamageEffect : public UGameplayEffect
+{
+	GENERATED_BODY()
+
+public:
+	UPUTestDamageEffect();
+};
+
+
+/* A native discharge effect, which adds one to the target's DamageTaken */
+UCLASS(NotBlueprintable, HideDropdown, Hidden)
+class UPUTestNativeDamageEffect : public UGameplayEffect
+{
+	GENERATED_BODY()
+
+public:
+	UPUTestNativeDamageEffect();
+};
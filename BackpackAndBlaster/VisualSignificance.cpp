@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectUnrest/Actors/VisualSignificance.h"
+#include "GameFramework/Actor.h"
+#include "SignificanceManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+
+
+namespace
+{
+	const FName SignificanceTag = TEXT("PUVisuals");
+
+	float MaxSignificantDistance = 3000.f;
+	FAutoConsoleVariableRef CVarMaxSignificantDistance(
+		TEXT("PU.Visuals.MaxSignificantDistance"),
+		MaxSignificantDistance,
+		TEXT("Distance from the closest viewpoint beyond which backpack and blaster visuals are skipped")
+	);
+
+	float RecentlyRenderedTolerance = 0.5f;
+	FAutoConsoleVariableRef CVarRecentlyRenderedTolerance(
+		TEXT("PU.Visuals.RecentlyRenderedTolerance"),
+		RecentlyRenderedTolerance,
+		TEXT("Seconds since last rendered after which backpack and blaster visuals are skipped")
+	);
+
+
+	/* Zero if off-screen or beyond the max distance, otherwise closer to one the closer the actor is to the viewpoint */
+	float CalculateSignificance(USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint)
+	{
+		const AActor* Actor = CastChecked<AActor>(ObjectInfo->GetObject());
+
+		if (!Actor->WasRecentlyRendered(RecentlyRenderedTolerance))
+		{
+			return 0.f;
+		}
+
+		const float Distance = FVector::Dist(Actor->GetActorLocation(), Viewpoint.GetLocation());
+
+		return FMath::Max(1.f - Distance / MaxSignificantDistance, 0.f);
+	}
+}
+
+
+void FPUVisualSignificance::Register(AActor* Actor, TFunction<void(bool bSignificant)> OnSignificanceChanged)
+{
+	check(Actor);
+
+	if (AreVisualsStripped())
+	{
+		return;
+	}
+
+	USignificanceManager* SignificanceManager = USignificanceManager::Get(Actor->GetWorld());
+
+	// Without a significance manager, visuals are always significant
+	if (SignificanceManager == nullptr)
+	{
+		return;
+	}
+
+	SignificanceManager->RegisterObject(
+		Actor,
+		SignificanceTag,
+		&CalculateSignificance,
+		USignificanceManager::EPostSignificanceType::Sequential,
+		[OnSignificanceChanged = MoveTemp(OnSignificanceChanged)](USignificanceManager::FManagedObjectInfo*, float OldSignificance, float Significance, bool bFinal)
+		{
+			if ((OldSignificance > 0.f) != (Significance > 0.f))
+			{
+				OnSignificanceChanged(Significance > 0.f);
+			}
+		}
+	);
+}
+
+bool FPUVisualSignificance::AreVisualsStripped()
+{
+	static const bool bVisualsStripped = IsRunningDedicatedServer() && !FParse::Param(FCommandLine::Get(), TEXT("PUKeepServerVisuals"));
+
+	return bVisualsStripped;
+}
+
+void FPUVisualSignificance::Unregister(AActor* Actor)
+{
+	if (USignificanceManager* SignificanceManager = USignificanceManager::Get(Actor->GetWorld()))
+	{
+		SignificanceManager->UnregisterObject(Actor);
+	}
+}
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/*
+ *	Registers backpacks and blasters with the world's significance manager so that the visuals of far away or off-screen owners
+ *	can be skipped. Actors should skip visual-only work while insignificant and apply their final visual state when they become
+ *	significant again. Requires the game's significance manager to be updated with the player viewpoints.
+ *	On dedicated servers visuals are stripped entirely: they are never significant and visual components aren't created.
+ */
+class PROJECTUNREST_API FPUVisualSignificance
+{
+public:
+	/* Registers the actor. OnSignificanceChanged is called on the game thread when it crosses the significance threshold. */
+	static void Register(AActor* Actor, TFunction<void(bool bSignificant)> OnSignificanceChanged);
+
+	static void Unregister(AActor* Actor);
+
+	/* Whether visuals are stripped, i.e. running as a dedicated server without -PUKeepServerVisuals (used to measure the difference) */
+	static bool AreVisualsStripped();
+};
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ProjectUnrest/Actors/ShootLoopTestFixture.h"
+#include "ProjectUnrest/Actors/ShootLoopTestTypes.h"
+#include "ProjectUnrest/Actors/Backpack.h"
+#include "ProjectUnrest/Actors/Battery.h"
+#include "ProjectUnrest/Actors/PUBlaster.h"
+#include "ProjectUnrest/Actors/BackpackMemory.h"
+#include "ProjectUnrest/Actors/VisualSignificance.h"
+#include "ProjectUnrest/Telemetry/PUPerfResults.h"
+
+
+/*
+ *	Measures the per-player tick cost and memory of the shoot loop actors. Whether visuals are stripped is fixed for the process, so
+ *	the metrics are suffixed with the mode: run the suite on a dedicated server, and again with -PUKeepServerVisuals, to compare.
+ */
+BEGIN_DEFINE_SPEC(FPUVisualStrippingPerfSpec, "ProjectUnrest.Perf.VisualStripping", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+	FPUShootLoopTestWorld TestWorld;
+
+	TArray<FPUTestShooter> Shooters;
+
+	const int32 NumShooters = 64;
+
+	const FString Suite = TEXT("VisualStripping");
+
+	FString GetMode() const;
+
+	/* Discharges the shooter's current battery, then rechambers or reloads directly, as Rechamber_BP and Reload_BP would */
+	void Shoot(const FPUTestShooter& Shooter) const;
+
+END_DEFINE_SPEC(FPUVisualStrippingPerfSpec)
+
+
+FString FPUVisualStrippingPerfSpec::GetMode() const
+{
+	return FPUVisualSignificance::AreVisualsStripped() ? TEXT("Stripped") : TEXT("Full");
+}
+
+void FPUVisualStrippingPerfSpec::Shoot(const FPUTestShooter& Shooter) const
+{
+	Shooter.Blaster->Discharge(FHitResult());
+
+	if (Shooter.Backpack->GetCurrentBatteryIndex() < FPUShootLoopTestWorld::BatteriesPerBackpack - 1)
+	{
+		Shooter.Backpack->CompleteRechamber();
+	}
+	else
+	{
+		Shooter.Backpack->CompleteReload();
+	}
+}
+
+
+void FPUVisualStrippingPerfSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		TestWorld.Create();
+
+		// Significant unless stripped, so the full mode pays for every visual update
+		for (int32 i = 0; i < NumShooters; i++)
+		{
+			Shooters.Add(TestWorld.SpawnShooter(true));
+		}
+	});
+
+	AfterEach([this]()
+	{
+		Shooters.Reset();
+		TestWorld.Destroy();
+	});
+
+
+	It("Tick cost per player", [this]()
+	{
+		// Every player shoots once per frame, far more often than in play, so the shoot loop dominates the frame
+		const double NsPerFrame = FPUPerfResults::MeasureNsPerCall(600, [this]()
+		{
+			for (const FPUTestShooter& Shooter : Shooters)
+			{
+				Shoot(Shooter);
+			}
+
+			TestWorld.Tick(1.f / 60.f);
+		});
+
+		FPUPerfResults::Write(Suite, FString::Printf(TEXT("PerPlayerFrameUs_%s"), *GetMode()), NsPerFrame / NumShooters / 1000.0, TEXT("us"));
+		TestTrue(TEXT("Measured tick cost"), NsPerFrame > 0.0);
+	});
+
+	It("Memory per player", [this]()
+	{
+		SIZE_T Bytes = 0;
+
+		for (const FPUTestShooter& Shooter : Shooters)
+		{
+			Bytes += FBackpackMemoryTracker::GetActorFootprint(Shooter.Backpack) + FBackpackMemoryTracker::GetActorFootprint(Shooter.Blaster);
+
+			for (int32 i = 0; i < FPUShootLoopTestWorld::BatteriesPerBackpack; i++)
+			{
+				Bytes += FBackpackMemoryTracker::GetActorFootprint(Shooter.Backpack->GetBatteryAtIndex(i));
+			}
+		}
+
+		FPUPerfResults::Write(Suite, FString::Printf(TEXT("PerPlayerKB_%s"), *GetMode()), Bytes / 1024.0 / NumShooters, TEXT("KB"));
+		TestTrue(TEXT("Measured memory"), Bytes > 0);
+	});
+}
+
+#endif
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectUnrest/Telemetry/PUPerfResults.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "HAL/FileManager.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogPUPerf, Log, All);
+
+
+
+double FPUPerfResults::MeasureNsPerCall(int32 Iterations, TFunctionRef<void()> Setup, TFunctionRef<void()> Body)
+{
+	check(Iterations > 0);
+
+	for (int32 i = 0; i < FMath::Max(Iterations / 10, 1); i++)
+	{
+		Setup();
+		Body();
+	}
+
+	uint64 BodyCycles = 0;
+
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		Setup();
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		Body();
+		BodyCycles += FPlatformTime::Cycles64() - StartCycles;
+	}
+
+	return FPlatformTime::ToSeconds64(BodyCycles) * 1e9 / Iterations;
+}
+
+double FPUPerfResults::MeasureNsPerCall(int32 Iterations, TFunctionRef<void()> Body)
+{
+	return MeasureNsPerCall(Iterations, []() {}, Body);
+}
+
+void FPUPerfResults::Write(const FString& Suite, const FString& Metric, double Value, const FString& Unit)
+{
+	const FString FilePath = GetFilePath();
+
+	FString Rows;
+
+	if (!IFileManager::Get().FileExists(*FilePath))
+	{
+		Rows += TEXT("Timestamp,BuildVersion,Platform,Suite,Metric,Value,Unit\n");
+	}
+
+	Rows += FString::Printf(TEXT("%s,%s,%s,%s,%s,%.3f,%s\n"),
+		*FDateTime::UtcNow().ToIso8601(), FApp::GetBuildVersion(), ANSI_TO_TCHAR(FPlatformProperties::IniPlatformName()), *Suite, *Metric, Value, *Unit);
+
+	if (!FFileHelper::SaveStringToFile(Rows, *FilePath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append))
+	{
+		UE_LOG(LogPUPerf, Error, TEXT("Failed to write perf results to %s"), *FilePath);
+		return;
+	}
+
+	UE_LOG(LogPUPerf, Display, TEXT("%s %s: %.3f %s"), *Suite, *Metric, Value, *Unit);
+}
+
+FString FPUPerfResults::GetFilePath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Automation") / TEXT("PUPerfResults.csv");
+}
+
+#endif
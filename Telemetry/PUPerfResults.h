@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+/*
+ *	Timing and output for performance specs. Results are appended to Saved/Automation/PUPerfResults.csv, one row per metric with the
+ *	build version and platform, so that a CI job can collect the file after each run and track the metrics over time.
+ */
+class PROJECTUNREST_API FPUPerfResults
+{
+public:
+	/*
+	 *	Runs Setup then Body the given number of times, after a tenth as many warm-up runs, and returns the average nanoseconds Body
+	 *	took. Only Body is timed.
+	 */
+	static double MeasureNsPerCall(int32 Iterations, TFunctionRef<void()> Setup, TFunctionRef<void()> Body);
+
+	/* Times Body alone, for calls that don't change the state the next call depends on */
+	static double MeasureNsPerCall(int32 Iterations, TFunctionRef<void()> Body);
+
+	/* Appends a row to the results file */
+	static void Write(const FString& Suite, const FString& Metric, double Value, const FString& Unit);
+
+	static FString GetFilePath();
+};
+
+#endif
@@ -0,0 +1,7 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectUnrest/Telemetry/PUProfiling.h"
+
+
+CSV_DEFINE_CATEGORY(PUShooting, true);
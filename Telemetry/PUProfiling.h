@@ -0,0 +1,13 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+
+/*
+ *	CSV profiler category for the shoot loop. Timings are accumulated per frame alongside a count of calls, so a capture
+ *	(e.g., "csvprofile start" or -csvCaptureFrames=N) gives a machine-readable cost per discharge, reload and recharge.
+ */
+CSV_DECLARE_CATEGORY_EXTERN(PUShooting);
@@ -0,0 +1,350 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectUnrest/Telemetry/PUTelemetry.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Compression.h"
+#include "Misc/Paths.h"
+#include "Containers/Queue.h"
+#include <atomic>
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogPUTelemetry, Log, All);
+
+
+namespace
+{
+	/* Number of records a thread buffers before handing them off to the writer */
+	constexpr int32 RecordsPerBuffer = 4096;
+
+	constexpr uint32 FileMagic = 0x4C455450; // "PTEL"
+	constexpr uint32 FileVersion = 1;
+
+	/* Game thread cost per record above which a warning is logged at the end of a session */
+	constexpr double MaxRecordCostNs = 1000.0;
+
+
+	/*
+	 *	Drains handed off buffers into one array per record field and writes them as compressed columns at the end of the session.
+	 */
+	class FTelemetryWriter final : public FRunnable
+	{
+	public:
+		explicit FTelemetryWriter(const FString& InFilePath)
+			: FilePath(InFilePath)
+		{
+			WorkEvent = FPlatformProcess::GetSynchEventFromPool();
+		}
+
+		virtual ~FTelemetryWriter() override
+		{
+			FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		}
+
+		/* Can be called from any thread */
+		void Submit(TArray<FPUTelemetryRecord>&& Records)
+		{
+			Pending.Enqueue(MoveTemp(Records));
+			WorkEvent->Trigger();
+		}
+
+		virtual uint32 Run() override
+		{
+			while (!bStopping)
+			{
+				WorkEvent->Wait(100);
+				Drain();
+			}
+
+			Drain();
+			WriteFile();
+
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopping = true;
+			WorkEvent->Trigger();
+		}
+
+	private:
+		FString FilePath;
+		TQueue<TArray<FPUTelemetryRecord>, EQueueMode::Mpsc> Pending;
+		FEvent* WorkEvent = nullptr;
+		std::atomic<bool> bStopping { false };
+
+		/* Columns */
+		TArray<float> Times;
+		TArray<float> Values;
+		TArray<uint32> SourceIds;
+		TArray<uint16> TagIndices;
+		TArray<uint8> Events;
+
+		/* Dictionary for the tag column */
+		TMap<FName, uint16> TagIndexMap;
+		TArray<FName> Tags;
+
+
+		void Drain()
+		{
+			TArray<FPUTelemetryRecord> Records;
+
+			while (Pending.Dequeue(Records))
+			{
+				for (const FPUTelemetryRecord& Record : Records)
+				{
+					uint16* TagIndex = TagIndexMap.Find(Record.Tag);
+
+					if (TagIndex == nullptr)
+					{
+						TagIndex = &TagIndexMap.Add(Record.Tag, static_cast<uint16>(Tags.Add(Record.Tag)));
+					}
+
+					Times.Add(Record.Time);
+					Values.Add(Record.Value);
+					SourceIds.Add(Record.SourceId);
+					TagIndices.Add(*TagIndex);
+					Events.Add(static_cast<uint8>(Record.Event));
+				}
+			}
+		}
+
+		void WriteFile()
+		{
+			TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileWriter(*FilePath));
+
+			if (!Ar)
+			{
+				UE_LOG(LogPUTelemetry, Error, TEXT("Failed to open telemetry file: %s"), *FilePath);
+				return;
+			}
+
+			uint32 Magic = FileMagic;
+			uint32 Version = FileVersion;
+			int32 NumRecords = Times.Num();
+			int32 NumTags = Tags.Num();
+
+			*Ar << Magic << Version << NumRecords << NumTags;
+
+			for (const FName& Tag : Tags)
+			{
+				FString TagString = Tag.ToString();
+				*Ar << TagString;
+			}
+
+			WriteColumn(*Ar, Times.GetData(), Times.Num() * Times.GetTypeSize());
+			WriteColumn(*Ar, Values.GetData(), Values.Num() * Values.GetTypeSize());
+			WriteColumn(*Ar, SourceIds.GetData(), SourceIds.Num() * SourceIds.GetTypeSize());
+			WriteColumn(*Ar, TagIndices.GetData(), TagIndices.Num() * TagIndices.GetTypeSize());
+			WriteColumn(*Ar, Events.GetData(), Events.Num() * Events.GetTypeSize());
+
+			UE_LOG(LogPUTelemetry, Log, TEXT("Wrote %d telemetry records to %s"), NumRecords, *FilePath);
+		}
+
+		/* Writes uncompressed size, compressed size, then the zlib compressed column */
+		static void WriteColumn(FArchive& Ar, const void* Data, int32 Size)
+		{
+			int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Size);
+			TArray<uint8> Compressed;
+			Compressed.SetNumUninitialized(CompressedSize);
+
+			const bool bCompressed = FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Data, Size);
+			check(bCompressed);
+
+			Ar << Size;
+			Ar << CompressedSize;
+			Ar.Serialize(Compressed.GetData(), CompressedSize);
+		}
+	};
+
+
+	std::atomic<bool> bSessionActive { false };
+	std::atomic<uint32> SessionSerial { 0 };
+	double SessionStartTime = 0.0;
+
+	/* Guards the writer, which is only touched when a buffer is handed off or a session begins/ends */
+	FCriticalSection WriterLock;
+	FTelemetryWriter* Writer = nullptr;
+	FRunnableThread* WriterThread = nullptr;
+
+
+	struct FThreadBuffer;
+
+	/* Every live thread buffer, so that ending a session can flush the buffers of all threads, not just its own */
+	FCriticalSection ThreadBuffersLock;
+	TArray<FThreadBuffer*> ThreadBuffers;
+
+
+	/*
+	 *	Per thread state. Serial ties the buffer to the session it was filled in, so stale records are dropped.
+	 *	Lock is only contended while a session ends, when another thread flushes the buffer.
+	 */
+	struct FThreadBuffer
+	{
+		FCriticalSection Lock;
+		TArray<FPUTelemetryRecord> Records;
+		uint32 Serial = 0;
+		uint64 RecordCycles = 0;
+		uint64 RecordCount = 0;
+
+		FThreadBuffer()
+		{
+			FScopeLock BuffersLock(&ThreadBuffersLock);
+			ThreadBuffers.Add(this);
+		}
+
+		/* Hands off what the exiting thread recorded in the current session */
+		~FThreadBuffer()
+		{
+			FScopeLock BuffersLock(&ThreadBuffersLock);
+			ThreadBuffers.RemoveSwap(this);
+
+			FScopeLock BufferLock(&Lock);
+			HandOff();
+		}
+
+		/* Submits the records to the writer if they belong to the current session. Lock must be held. */
+		void HandOff()
+		{
+			{
+				FScopeLock WriterScopeLock(&WriterLock);
+
+				if (Writer && Records.Num() > 0 && Serial == SessionSerial.load(std::memory_order_relaxed))
+				{
+					Writer->Submit(MoveTemp(Records));
+				}
+			}
+
+			Records.Reset();
+			Records.Reserve(RecordsPerBuffer);
+		}
+	};
+
+	thread_local FThreadBuffer ThreadBuffer;
+
+
+	FAutoConsoleCommand BeginSessionCommand(
+		TEXT("PU.Telemetry.Begin"),
+		TEXT("Begins a gameplay telemetry session. Optional argument: output file name, relative to Saved/Telemetry"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const FString FileName = Args.Num() > 0 ? Args[0] : FDateTime::Now().ToString() + TEXT(".ptel");
+			FPUTelemetry::BeginSession(FPaths::ProjectSavedDir() / TEXT("Telemetry") / FileName);
+		})
+	);
+
+	FAutoConsoleCommand EndSessionCommand(
+		TEXT("PU.Telemetry.End"),
+		TEXT("Ends the current gameplay telemetry session and writes its file"),
+		FConsoleCommandDelegate::CreateStatic(&FPUTelemetry::EndSession)
+	);
+}
+
+
+void FPUTelemetry::BeginSession(const FString& FilePath)
+{
+	if (IsSessionActive())
+	{
+		EndSession();
+	}
+
+	FScopeLock Lock(&WriterLock);
+
+	Writer = new FTelemetryWriter(FilePath);
+	WriterThread = FRunnableThread::Create(Writer, TEXT("PUTelemetryWriter"), 0, TPri_BelowNormal);
+
+	SessionStartTime = FPlatformTime::Seconds();
+	SessionSerial.fetch_add(1, std::memory_order_relaxed);
+	bSessionActive.store(true, std::memory_order_release);
+}
+
+void FPUTelemetry::EndSession()
+{
+	if (!bSessionActive.exchange(false, std::memory_order_acq_rel))
+	{
+		return;
+	}
+
+	uint64 RecordCycles = 0;
+	uint64 RecordCount = 0;
+
+	{
+		FScopeLock BuffersLock(&ThreadBuffersLock);
+
+		for (FThreadBuffer* Buffer : ThreadBuffers)
+		{
+			FScopeLock BufferLock(&Buffer->Lock);
+
+			Buffer->HandOff();
+
+			RecordCycles += Buffer->RecordCycles;
+			RecordCount += Buffer->RecordCount;
+			Buffer->RecordCycles = 0;
+			Buffer->RecordCount = 0;
+		}
+	}
+
+	if (RecordCount > 0)
+	{
+		const double AverageNs = FPlatformTime::ToSeconds64(RecordCycles) * 1e9 / RecordCount;
+
+		UE_CLOG(AverageNs > MaxRecordCostNs, LogPUTelemetry, Warning, TEXT("Telemetry record cost %.1f ns exceeds budget of %.1f ns"), AverageNs, MaxRecordCostNs);
+		UE_LOG(LogPUTelemetry, Log, TEXT("Recorded %llu events at %.1f ns each"), RecordCount, AverageNs);
+	}
+
+	FScopeLock Lock(&WriterLock);
+
+	// Blocks until the file is written. Sessions end between matches, so this does not need to be hidden.
+	WriterThread->Kill(true);
+	delete WriterThread;
+	delete Writer;
+
+	WriterThread = nullptr;
+	Writer = nullptr;
+}
+
+bool FPUTelemetry::IsSessionActive()
+{
+	return bSessionActive.load(std::memory_order_relaxed);
+}
+
+void FPUTelemetry::Record(EPUTelemetryEvent Event, FName Tag, float Value, uint32 SourceId)
+{
+	if (!IsSessionActive())
+	{
+		return;
+	}
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	FThreadBuffer& Buffer = ThreadBuffer;
+	const uint32 Serial = SessionSerial.load(std::memory_order_relaxed);
+
+	FScopeLock BufferLock(&Buffer.Lock);
+
+	if (Buffer.Serial != Serial)
+	{
+		Buffer.Records.Reset();
+		Buffer.Records.Reserve(RecordsPerBuffer);
+		Buffer.Serial = Serial;
+	}
+
+	FPUTelemetryRecord& Record = Buffer.Records.AddDefaulted_GetRef();
+	Record.Time = static_cast<float>(FPlatformTime::Seconds() - SessionStartTime);
+	Record.Value = Value;
+	Record.SourceId = SourceId;
+	Record.Tag = Tag;
+	Record.Event = Event;
+
+	if (Buffer.Records.Num() >= RecordsPerBuffer)
+	{
+		Buffer.HandOff();
+	}
+
+	Buffer.RecordCycles += FPlatformTime::Cycles64() - StartCycles;
+	++Buffer.RecordCount;
+}
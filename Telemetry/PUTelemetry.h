@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/* The gameplay events that can be recorded by the telemetry sink */
+enum class EPUTelemetryEvent : uint8
+{
+	Shot,
+	Rechamber,
+	Reload,
+	RechargeStart,
+	RechargeComplete
+};
+
+
+/*
+ *	A single fixed-width telemetry record. Trivially copyable so that whole buffers can be handed off to the writer as is.
+ *	Tag is the battery type for shots, and the recharge tag for recharges.
+ */
+struct FPUTelemetryRecord
+{
+	/* Seconds since the session began */
+	float Time = 0.f;
+
+	/* Event specific value (e.g., discharge ability level, duration of the charge a recharge starts with, charges after recharge) */
+	float Value = 0.f;
+
+	/* Unique ID of the actor the event happened on */
+	uint32 SourceId = 0;
+
+	FName Tag;
+
+	EPUTelemetryEvent Event = EPUTelemetryEvent::Shot;
+};
+
+
+/*
+ *	Asynchronous gameplay telemetry sink used for balancing. Records are appended to a thread-local buffer, which is handed off to a
+ *	background writer once full. When the session ends, the writer produces a compressed columnar file (one column per record field).
+ *	Record is cheap enough to be called on the shot path; its own cost is measured and reported when the session ends.
+ */
+class PROJECTUNREST_API FPUTelemetry
+{
+public:
+	/* Starts a session that will be written to the given file when it ends. Ends the current session, if any. */
+	static void BeginSession(const FString& FilePath);
+
+	/* Flushes the buffers of every thread, waits for the writer to write the file, and reports the average cost per record */
+	static void EndSession();
+
+	static bool IsSessionActive();
+
+	/* Appends a record to the calling thread's buffer. Does nothing if there is no active session. */
+	static void Record(EPUTelemetryEvent Event, FName Tag, float Value, uint32 SourceId);
+};